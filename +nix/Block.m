@@ -29,18 +29,36 @@ classdef Block < nix.NamedEntity & nix.MetadataMixIn
         
         %-- As "datatype" provide one of the nix.DataTypes. Alternatively
         %-- a string stating one of the datatypes supported by nix can be provided.
-        function da = create_data_array(obj, name, nixtype, datatype, shape)
+        %-- Optional settings are passed as fields of the struct "opts":
+        %--   storage: 'column-major' stores the data in matlab memory layout,
+        %--            i.e. with the dimensions reversed in the file, which
+        %--            saves the transposition on every read and write.
+        %--   chunks:  chunk shape, one entry per dimension.
+        %--   deflate: compression level 1-9, 0 (default) for none.
+        %--   shuffle: true to shuffle bytes before compression.
+        %--   fill:    value of elements that have not been written.
+        %--   contiguous: true stores the data in one block without chunks,
+        %--            which files opened ReadOnly read from a memory
+        %--            mapping; the shape cannot change afterwards.
+        %-- The layout actually used is reported in the info of the DataArray.
+        function da = create_data_array(obj, name, nixtype, datatype, shape, opts)
+            if ~exist('opts', 'var')
+                opts = struct();
+            end
             handle = nix_mx('Block::createDataArray', obj.nix_handle, ...
-                name, nixtype, datatype, shape);
+                name, nixtype, datatype, shape, opts);
             da = nix.DataArray(handle);
             obj.dataArraysCache.lastUpdate = 0;
         end
         
-        function da = create_data_array_from_data(obj, name, nixtype, data)
+        function da = create_data_array_from_data(obj, name, nixtype, data, opts)
+            if ~exist('opts', 'var')
+                opts = struct();
+            end
             shape = size(data);
             dtype = class(data);
             
-            da = obj.create_data_array(name, nixtype, dtype, shape);
+            da = obj.create_data_array(name, nixtype, dtype, shape, opts);
             da.write_all(data);
         end
 
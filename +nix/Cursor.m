@@ -0,0 +1,35 @@
+classdef Cursor < nix.Entity
+    %Cursor walks the data of a DataArray in chunk aligned blocks
+    %   blocks are visited with the first dimension changing fastest
+    %   for column-major and the last one for row-major DataArrays
+    
+    properties (Hidden)
+        % namespace reference for nix-mx functions
+        alias = 'Cursor'
+    end
+    
+    methods
+        function obj = Cursor(h)
+            obj@nix.Entity(h);
+            
+            % assign dynamic properties
+            nix.Dynamic.add_dyn_attr(obj, 'shape', 'r');
+            nix.Dynamic.add_dyn_attr(obj, 'blockShape', 'r');
+        end;
+
+        function hasNext = has_next(obj)
+            hasNext = nix_mx('Cursor::hasNext', obj.nix_handle);
+        end;
+
+        %-- offset is the (Matlab-like, 1-based) position of the block
+        function [data, offset] = next(obj)
+            [data, offset] = nix_mx('Cursor::next', obj.nix_handle);
+            offset = double(offset) + 1;
+        end;
+
+        function reset(obj)
+            nix_mx('Cursor::reset', obj.nix_handle);
+        end;
+    end
+    
+end
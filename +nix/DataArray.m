@@ -48,11 +48,18 @@ classdef DataArray < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
                            disp('some dimension type is unknown! skip')
                     end
                 end;
+                if obj.is_column_major()
+                    % descriptors are stored in file order
+                    obj.dimsCache.data = flipud(obj.dimsCache.data);
+                end;
                 obj.dimsCache.lastUpdate = obj.updatedAt;
             end;
             dimensions = obj.dimsCache.data;
         end;
         
+        %-- Column-major arrays keep their dimension descriptors in file
+        %-- order, i.e. appended dimensions describe the matlab dimensions
+        %-- starting with the last one.
         function dim = append_set_dimension(obj)
             func_name = strcat(obj.alias, '::append_set_dimension');
             dim = nix.SetDimension(nix_mx(func_name, obj.nix_handle));
@@ -82,18 +89,268 @@ classdef DataArray < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
         % -----------------
 
         function data = read_all(obj)
-           tmp = nix_mx('DataArray::readAll', obj.nix_handle);
-           % data must agree with file & dimensions
-           % see mkarray.cc(42)
-           data = permute(tmp, length(size(tmp)):-1:1);
+           % data is transposed to agree with file & dimensions
+           % on the c++ side, see mkarray.cc; compressed chunks
+           % are inflated in parallel, see chunkread.h, contiguous
+           % data is copied from a mapping, see mmapread.h
+           data = nix_mx('DataArray::readAll', obj.nix_handle);
         end;
         
         function write_all(obj, data)  % TODO add (optional) offset
-           % data must agree with file & dimensions
-           % see mkarray.cc(42)
-           tmp = permute(data, length(size(data)):-1:1);
-           nix_mx('DataArray::writeAll', obj.nix_handle, tmp);
+           % compressed chunks are deflated in parallel, see chunkwrite.h
+           nix_mx('DataArray::writeAll', obj.nix_handle, obj.to_file_order(data));
         end;
-        
+
+        %-- Stores single or double data in the integer type of the
+        %-- DataArray as round((data - offset) / scale), saturated at
+        %-- the limits of the type (NaN becomes 0); polynom_coefficients
+        %-- become [offset scale], so read_calibrated returns the data
+        %-- up to the quantization. Conversion happens a block at a time
+        %-- without a copy of the data. Returns the number of values
+        %-- that were clipped.
+        function clipped = write_quantized(obj, data, scale, offset)
+           if ~exist('offset', 'var')
+               offset = 0;
+           end
+           assert(isfloat(data), 'Only single or double data can be quantized');
+           clipped = nix_mx('DataArray::writeQuantized', obj.nix_handle, ...
+               obj.to_file_order(data), scale, offset);
+        end;
+
+        %-- offset is the (Matlab-like, 1-based) start index and count
+        %-- the number of elements to read along every dimension
+        function data = read_range(obj, offset, count)
+           % convert Matlab-like to C-like index
+           assert(all(offset > 0), 'Offset indices must be positive');
+           data = nix_mx('DataArray::readRange', obj.nix_handle, offset - 1, count);
+        end;
+
+        %-- Reads the data calibrated with polynom_coefficients and
+        %-- expansionOrigin, sum_k c(k) * (data - origin)^(k-1), as
+        %-- 'double' (default) or 'single'. The stored values are read
+        %-- and calibrated a block at a time, so the result is the only
+        %-- array of that size. Optional offset (1-based) and count
+        %-- select a range like in read_range.
+        function data = read_calibrated(obj, precision, offset, count)
+           if ~exist('precision', 'var')
+               precision = 'double';
+           end
+           assert(any(strcmp(precision, {'double', 'single'})), ...
+               'Precision must be double or single');
+           if ~exist('offset', 'var')
+               offset = [];
+               count = [];
+           else
+               assert(all(offset > 0), 'Offset indices must be positive');
+               offset = offset - 1;
+           end
+           data = nix_mx('DataArray::readCalibrated', obj.nix_handle, precision, offset, count);
+        end;
+
+        %-- Statistics along dimension dim (default 1), computed while
+        %-- the data is read a block at a time: a struct with mean, std,
+        %-- min, max and rms, each of the shape of the data with
+        %-- size 1 along dim. Options: 'edges' adds a histogram with
+        %-- the counts of histcounts along dim, 'calibrated' applies
+        %-- the polynomial like read_calibrated.
+        function stats = reduce(obj, dim, opts)
+           if ~exist('dim', 'var')
+               dim = 1;
+           end
+           if ~exist('opts', 'var')
+               opts = struct();
+           end
+           assert(dim > 0, 'Dimension must be positive');
+           stats = nix_mx('DataArray::reduce', obj.nix_handle, dim - 1, opts);
+        end;
+
+        %-- Stores the minimum and maximum of every chunk (of every
+        %-- block of rows without chunks) in the file, next to the data.
+        %-- Writes and appends of nix-mx keep it up to date; data
+        %-- written by other programs requires a rebuild.
+        function [] = build_zone_map(obj)
+           nix_mx('DataArray::buildZoneMap', obj.nix_handle);
+        end;
+
+        function [] = drop_zone_map(obj)
+           nix_mx('DataArray::dropZoneMap', obj.nix_handle);
+        end;
+
+        %-- Linear indices of the stored values in [lo, hi], like
+        %-- find(data >= lo & data <= hi). With a zone map only the
+        %-- chunks whose values may lie in the range are read.
+        function idx = find_range(obj, lo, hi)
+           idx = nix_mx('DataArray::findRange', obj.nix_handle, double(lo), double(hi));
+        end;
+
+        %-- Stores the minima and maxima of the data in bins of 8, 64,
+        %-- 512, ... samples along dimension dim (the first sampled
+        %-- dimension by default), which needs a SampledDimension.
+        %-- Writes and appends of nix-mx keep it up to date.
+        function [] = build_envelope(obj, dim)
+           if ~exist('dim', 'var')
+               dim = 0;
+           end
+           nix_mx('DataArray::buildEnvelope', obj.nix_handle, double(dim));
+        end;
+
+        function [] = drop_envelope(obj)
+           nix_mx('DataArray::dropEnvelope', obj.nix_handle);
+        end;
+
+        %-- Minima and maxima of the samples with times in [t0, t1] in
+        %-- npix pixels for plotting, read from the coarsest envelope
+        %-- level that still has two bins per pixel. Returns a struct
+        %-- with min and max, shaped like the data with npix along the
+        %-- sampled dimension, the time of the first sample of every
+        %-- pixel, and the level read (0 reads the data).
+        function env = read_envelope(obj, t0, t1, npix)
+           assert(npix > 0, 'At least one pixel is required');
+           env = nix_mx('DataArray::readEnvelope', obj.nix_handle, ...
+               double(t0), double(t1), double(npix));
+        end;
+
+        %-- Returns data(idx1, idx2, ...) like matlab indexing: one index
+        %-- vector (or ':') per dimension, in any order and with repetitions.
+        function data = read_indexed(obj, varargin)
+           shape = obj.shape;
+           assert(length(varargin) == length(shape), ...
+               'One index vector per dimension is required');
+           idx = cell(1, length(varargin));
+           for i = 1:length(varargin)
+               if ischar(varargin{i}) && strcmp(varargin{i}, ':')
+                   idx{i} = 0:double(shape(i)) - 1;
+               else
+                   idx{i} = double(varargin{i}) - 1;
+               end;
+           end;
+           data = nix_mx('DataArray::readIndexed', obj.nix_handle, idx);
+        end;
+
+        %-- Returns the values at the subscripts given as rows of subs
+        %-- (one column per dimension) as a column vector.
+        function data = read_points(obj, subs)
+           data = nix_mx('DataArray::readPoints', obj.nix_handle, double(subs) - 1);
+        end;
+
+        %-- Decimated read: count blocks of block elements (default 1),
+        %-- stride elements apart, starting at the (1-based) offset.
+        function data = read_strided(obj, offset, stride, count, block)
+           if nargin < 5
+               block = ones(size(count));
+           end;
+           assert(all(offset > 0), 'Offset indices must be positive');
+           data = nix_mx('DataArray::readStrided', obj.nix_handle, ...
+               offset - 1, stride, count, block);
+        end;
+
+        %-- With prefetch enabled, every read_range/read_into starts reading
+        %-- the next window of a sequential scan in the background (same
+        %-- step as between the last two reads, or else the next window
+        %-- along the last dimension). opts.maxBytes bounds the window
+        %-- size that is read ahead (default 64 MB).
+        function set_prefetch(obj, enable, opts)
+           if nargin < 3
+               opts = struct();
+           end;
+           nix_mx('DataArray::setPrefetch', obj.nix_handle, logical(enable), opts);
+        end;
+
+        %-- With async write enabled, write_all/write_range/append_data
+        %-- copy the data and return, a background thread writes it.
+        %-- Reads wait for the queued writes; opts.maxBytes bounds the
+        %-- queued data (default 256 MB). Errors of the background
+        %-- writes are raised by the next call on this DataArray.
+        function set_async_write(obj, enable, opts)
+           if nargin < 3
+               opts = struct();
+           end;
+           nix_mx('DataArray::setAsyncWrite', obj.nix_handle, logical(enable), opts);
+        end;
+
+        %-- Blocks until all queued writes are done.
+        function wait_writes(obj)
+           nix_mx('DataArray::waitWrites', obj.nix_handle);
+        end;
+
+        %-- Like wait_writes, then flushes the file to disk.
+        function flush_writes(obj)
+           nix_mx('DataArray::flushWrites', obj.nix_handle);
+        end;
+
+        %-- Cursor over the data in blocks of opts.blocks chunks along
+        %-- every dimension (default one chunk); data without chunks is
+        %-- walked in blocks of whole rows.
+        function cursor = open_cursor(obj, opts)
+           if nargin < 2
+               opts = struct();
+           end;
+           cursor = nix.Cursor(nix_mx('DataArray::openCursor', obj.nix_handle, opts));
+        end;
+
+        %-- Fills buf in place with the data starting at the (1-based)
+        %-- offset; buf must have the class of the data and the shape of
+        %-- the selection. Matlab shares data between copies of a variable,
+        %-- all of which see the new content, so the buffer should be
+        %-- allocated once (e.g. with zeros) and reused.
+        function read_into(obj, buf, offset)
+           assert(all(offset > 0), 'Offset indices must be positive');
+           nix_mx('DataArray::readInto', obj.nix_handle, buf, offset - 1);
+        end;
+
+        function write_range(obj, data, offset)
+           % convert Matlab-like to C-like index
+           assert(all(offset > 0), 'Offset indices must be positive');
+           nix_mx('DataArray::writeRange', obj.nix_handle, ...
+               obj.to_file_order(data), offset - 1);
+        end;
+
+        %-- Appends data along the (1-based) dimension axis; all other
+        %-- dimensions of data must match the DataArray. The dataset is
+        %-- grown by opts.growth chunks at a time (default 4, 0 grows
+        %-- exactly), the surplus is trimmed by finish_append or when the
+        %-- file is closed. Appending along a range dimension requires
+        %-- the new ticks in opts.ticks.
+        function append_data(obj, data, axis, opts)
+           if nargin < 4
+               opts = struct();
+           end;
+           assert(axis > 0, 'Axis must be positive');
+           nix_mx('DataArray::appendData', obj.nix_handle, ...
+               obj.to_file_order(data), axis - 1, opts);
+           obj.info = nix_mx('DataArray::describe', obj.nix_handle);
+        end;
+
+        %-- Reloads extent and dimensions from the file, e.g. to read
+        %-- what a SWMR writer has appended since the last call.
+        function refresh(obj)
+           nix_mx('DataArray::refresh', obj.nix_handle);
+           obj.info = nix_mx('DataArray::describe', obj.nix_handle);
+           obj.dimsCache.lastUpdate = 0;
+        end;
+
+        function finish_append(obj)
+           nix_mx('DataArray::finishAppend', obj.nix_handle);
+        end;
+
+        function colMajor = is_column_major(obj)
+           colMajor = strcmp(obj.info.storage, 'column-major');
+        end;
+
+    end;
+
+    methods (Access = protected)
+
+        function tmp = to_file_order(obj, data)
+           if obj.is_column_major()
+               % column-major arrays are stored in matlab layout
+               tmp = data;
+           else
+               % data must agree with file & dimensions
+               % see mkarray.cc
+               tmp = permute(data, max(ndims(data), length(obj.shape)):-1:1);
+           end;
+        end;
+
     end;
 end
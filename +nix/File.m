@@ -7,11 +7,56 @@ classdef File < nix.Entity
     end;
     
     methods
-        function obj = File(path, mode)
+        %-- Optional HDF5 access settings are passed as fields of "opts":
+        %--   chunkCacheBytes:    raw data chunk cache per dataset (default 1 MB)
+        %--   chunkCacheSlots:    hash slots of the chunk cache
+        %--   chunkCachePolicy:   0..1, preference for evicting fully read chunks
+        %--   metadataCacheBytes: size of the metadata cache
+        %--   sieveBufferBytes:   buffer for small reads of contiguous data
+        %--   preload:            true reads the whole file into memory
+        %--                       (system cache) on open and keeps all
+        %--                       metadata that has been read cached,
+        %--                       for metadata-heavy traversals
+        %--   metaBlockBytes:     metadata is allocated in blocks of this size
+        %--   latestFormat:       true to use the latest HDF5 file format,
+        %--                       files may not open with HDF5 before 1.10
+        %--   swmr:               true opens a file in ReadOnly mode for
+        %--                       reading while a SWMR writer appends to
+        %--                       it, see DataArray.refresh; the file
+        %--                       must use the latest format. In the
+        %--                       other modes the file is opened as SWMR
+        %--                       writer: DataArray.append_data becomes
+        %--                       visible to readers when the file is
+        %--                       flushed. No entities can be created.
+        %--   flushEvery:         SWMR writer flushes every N appends
+        %--   flushInterval:      SWMR writer flushes at most this many
+        %--                       milliseconds after an append
+        %--                       (without either, only flush() does)
+        %-- For files opened ReadOnly only:
+        %--   sharedCache:        name of a chunk cache in shared memory
+        %--                       that processes on this machine read
+        %--                       through, e.g. the workers of a parpool;
+        %--                       decompressed chunks stay there for later
+        %--                       reads and sessions until it is removed
+        %--                       with nix.File.remove_shared_cache (POSIX)
+        %--   sharedCacheBytes:   size of a new shared cache (default 256 MB)
+        %--   sharedCacheSlotBytes: largest chunk in a new shared cache
+        %--                       (default 1 MB), larger ones are not cached
+        %-- For new files (mode Overwrite) only:
+        %--   pageSize:           paged file space with pages of this size,
+        %--                       keeps metadata together (HDF5 1.10.1)
+        %-- For files created with pageSize:
+        %--   pageBufferBytes:    page buffer, at least one page
+        %-- Settings only apply if the file is not open already; the
+        %-- effective values are reported in obj.info.
+        function obj = File(path, mode, opts)
             if ~exist('mode', 'var')
                 mode = nix.FileMode.ReadWrite; %default to ReadWrite
             end
-            h = nix_mx('File::open', path, mode); 
+            if ~exist('opts', 'var')
+                opts = struct();
+            end
+            h = nix_mx('File::open', path, mode, opts); 
             obj@nix.Entity(h);
             
             % assign relations
@@ -21,6 +66,46 @@ classdef File < nix.Entity
             obj.info = nix_mx('File::describe', obj.nix_handle);
         end
         
+        %-- Writes everything to disk, incl. queued DataArray writes;
+        %-- SWMR readers see the data from then on.
+        function flush(obj)
+            nix_mx('File::flush', obj.nix_handle);
+        end
+
+        %-- Starts n local processes that serve read_batch in parallel,
+        %-- each with its own HDF5 library (POSIX only). The file must
+        %-- be open ReadOnly or for SWMR; the processes see what has
+        %-- been flushed. Optional fields of "opts":
+        %--   bufferBytes: memory shared with each process (default
+        %--                64 MB), larger blocks are read in pieces
+        %--   program:     path of nix_mx_reader (default: next to nix_mx)
+        function start_readers(obj, n, opts)
+            if ~exist('opts', 'var')
+                opts = struct();
+            end
+            nix_mx('File::startReaders', obj.nix_handle, n, opts);
+        end
+
+        function stop_readers(obj)
+            nix_mx('File::stopReaders', obj.nix_handle);
+        end
+
+        %-- Reads several DataArrays at once: data{i} is the same as
+        %-- arrays{i}.read_range(offsets{i}, counts{i}), or read_all()
+        %-- without offsets and counts. The reads are spread over the
+        %-- processes of start_readers, if any.
+        function data = read_batch(obj, arrays, offsets, counts)
+            handles = cellfun(@(a) a.nix_handle, arrays, 'UniformOutput', false);
+            if ~exist('offsets', 'var')
+                offsets = {};
+                counts = {};
+            end
+            % convert Matlab-like to C-like index
+            assert(all(cellfun(@(o) all(o > 0), offsets)), 'Offset indices must be positive');
+            offsets = cellfun(@(o) o - 1, offsets, 'UniformOutput', false);
+            data = nix_mx('File::readBatch', obj.nix_handle, handles, offsets, counts);
+        end
+
         % ----------------
         % Block methods
         % ----------------
@@ -60,5 +145,15 @@ classdef File < nix.Entity
         end;
 
     end
+
+    methods (Static)
+
+        %-- Removes the shared chunk cache of that name (see the
+        %-- sharedCache option); processes using it keep their view.
+        function remove_shared_cache(name)
+            nix_mx('File::removeSharedCache', name);
+        end
+
+    end
 end
 
@@ -43,12 +43,17 @@ classdef MultiTag < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
             % convert Matlab-like to C-like index
             assert(pos_index > 0, 'Position index must be positive');
             assert(ref_index > 0, 'Reference index must be positive');
-            tmp = nix_mx('MultiTag::retrieveData', obj.nix_handle, ...
+            data = nix_mx('MultiTag::retrieveData', obj.nix_handle, ...
                 pos_index - 1, ref_index - 1);
-            
-            % data must agree with file & dimensions
-            % see mkarray.cc(42)
-            data = permute(tmp, length(size(tmp)):-1:1);
+        end;
+
+        %-- like retrieve_data, but fills the preallocated buf in place,
+        %-- see DataArray.read_into
+        function retrieve_data_into(obj, pos_index, ref_index, buf)
+            assert(pos_index > 0, 'Position index must be positive');
+            assert(ref_index > 0, 'Reference index must be positive');
+            nix_mx('MultiTag::retrieveDataInto', obj.nix_handle, ...
+                pos_index - 1, ref_index - 1, buf);
         end;
         
         % ------------------
@@ -79,12 +84,8 @@ classdef MultiTag < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
             % convert Matlab-like to C-like index
             assert(pos_index > 0, 'Position index must be positive');
             assert(fea_index > 0, 'Feature index must be positive');
-            tmp = nix_mx('MultiTag::featureRetrieveData', obj.nix_handle, ...
+            data = nix_mx('MultiTag::featureRetrieveData', obj.nix_handle, ...
                 pos_index - 1, fea_index - 1);
-            
-            % data must agree with file & dimensions
-            % see mkarray.cc(42)
-            data = permute(tmp, length(size(tmp)):-1:1);
         end;
         
         % ------------------
@@ -44,11 +44,14 @@ classdef Tag < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
         function data = retrieve_data(obj, index)
             % convert Matlab-like to C-like index
             assert(index > 0, 'Subscript indices must be positive');
-            tmp = nix_mx('Tag::retrieveData', obj.nix_handle, index - 1);
-            
-            % data must agree with file & dimensions
-            % see mkarray.cc(42)
-            data = permute(tmp, length(size(tmp)):-1:1);
+            data = nix_mx('Tag::retrieveData', obj.nix_handle, index - 1);
+        end;
+
+        %-- like retrieve_data, but fills the preallocated buf in place,
+        %-- see DataArray.read_into
+        function retrieve_data_into(obj, index, buf)
+            assert(index > 0, 'Subscript indices must be positive');
+            nix_mx('Tag::retrieveDataInto', obj.nix_handle, index - 1, buf);
         end;
 
         % ------------------
@@ -78,11 +81,7 @@ classdef Tag < nix.NamedEntity & nix.MetadataMixIn & nix.SourcesMixIn
         function data = retrieve_feature_data(obj, index)
             % convert Matlab-like to C-like index
             assert(index > 0, 'Subscript indices must be positive');
-            tmp = nix_mx('Tag::featureRetrieveData', obj.nix_handle, index - 1);
-            
-            % data must agree with file & dimensions
-            % see mkarray.cc(42)
-            data = permute(tmp, length(size(tmp)):-1:1);
+            data = nix_mx('Tag::featureRetrieveData', obj.nix_handle, index - 1);
         end;
 
     end;
@@ -0,0 +1,56 @@
+function BenchCompressed( n_runs )
+%BENCHCOMPRESSED compares read_all and write_all of compressed data
+%   with HDF5's filter pipeline. read_all and write_all filter the chunks
+%   on all cores, while read_range and write_range of the whole extent
+%   have HDF5 inflate and deflate them one by one.
+
+    if ~exist('n_runs', 'var')
+        n_runs = 5;
+    end
+
+    f = nix.File(fullfile(tempdir, 'nix_mx_bench_compressed.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('bench', 'nixBlock');
+
+    shape = [64 1000000];
+    data = cumsum(randn(shape), 2);
+    layouts = {struct('chunks', [64 16384], 'deflate', 1), ...
+               struct('chunks', [64 16384], 'deflate', 6, 'shuffle', true), ...
+               struct('chunks', [8 4096], 'deflate', 4, 'shuffle', true)};
+
+    fprintf('%-36s %12s %12s %12s %12s\n', 'layout', 'read_all', 'read_range', ...
+        'write_all', 'write_range');
+    for i = 1:length(layouts)
+        opts = layouts{i};
+        da = b.create_data_array(sprintf('z%d', i), 'bench', 'double', shape, opts);
+
+        t_wall = time_it(@() write_it(@() da.write_all(data)), n_runs);
+        t_wrange = time_it(@() write_it(@() da.write_range(data, [1 1])), n_runs);
+
+        t_all = time_it(@() da.read_all(), n_runs);
+        t_range = time_it(@() da.read_range([1 1], shape), n_runs);
+
+        desc = sprintf('chunks %s, deflate %d', mat2str(opts.chunks), opts.deflate);
+        if isfield(opts, 'shuffle')
+            desc = [desc ', shuffle'];
+        end
+        fprintf('%-36s %10.3f s %10.3f s %10.3f s %10.3f s\n', desc, ...
+            t_all, t_range, t_wall, t_wrange);
+
+        b.delete_data_array(da);
+    end
+end
+
+function t = time_it(fn, n_runs)
+    t = inf;
+    for i = 1:n_runs
+        tic;
+        tmp = fn();
+        t = min(t, toc);
+        clear tmp;
+    end
+end
+
+function res = write_it(fn)
+    fn();
+    res = [];
+end
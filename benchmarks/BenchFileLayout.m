@@ -0,0 +1,87 @@
+function BenchFileLayout( n_runs )
+%BENCHFILELAYOUT compares opening and traversing files of different layouts
+%   Writes the same content (blocks with data arrays, nested sections
+%   with properties) to a file with the default HDF5 file space layout
+%   and to one created with paged file space, the latest file format and
+%   larger metadata blocks, then times opening each file and visiting
+%   every entity.
+%
+%   HDF5 caches are empty on every open, the operating system cache is
+%   not: for cold numbers, drop it before each run (e.g. on Linux
+%   "sync; echo 3 > /proc/sys/vm/drop_caches" as root) or put the files
+%   on network storage with n_runs = 1.
+
+    if ~exist('n_runs', 'var')
+        n_runs = 5;
+    end
+
+    layouts = {
+        'default', struct(), struct();
+        'paged', struct('pageSize', 2^16, 'pageBufferBytes', 2^22, ...
+            'metaBlockBytes', 2^16, 'latestFormat', true), ...
+            struct('pageBufferBytes', 2^22)
+    };
+
+    fprintf('%-10s %12s %12s %12s\n', 'layout', 'size', 'open', 'traversal');
+    for i = 1:size(layouts, 1)
+        fname = fullfile(tempdir, sprintf('nix_mx_bench_layout_%s.h5', layouts{i, 1}));
+        populate(fname, layouts{i, 2});
+
+        file_info = dir(fname);
+        t_open = inf;
+        t_walk = inf;
+
+        for j = 1:n_runs
+            tic;
+            f = nix.File(fname, nix.FileMode.ReadOnly, layouts{i, 3});
+            t_open = min(t_open, toc);
+
+            tic;
+            traverse(f);
+            t_walk = min(t_walk, toc);
+            clear f;
+        end
+
+        fprintf('%-10s %9.1f MB %10.3f s %10.3f s\n', layouts{i, 1}, ...
+            file_info.bytes / 2^20, t_open, t_walk);
+    end
+end
+
+function populate(fname, opts)
+    f = nix.File(fname, nix.FileMode.Overwrite, opts);
+
+    for i = 1:20
+        b = f.createBlock(sprintf('block%d', i), 'bench');
+        for j = 1:25
+            b.create_data_array_from_data(sprintf('da%d', j), 'bench', rand(16, 256));
+        end
+    end
+
+    for i = 1:20
+        s = f.createSection(sprintf('section%d', i), 'bench');
+        for j = 1:10
+            sub = s.createSection(sprintf('sub%d', j), 'bench');
+            for k = 1:10
+                sub.create_property_with_value(sprintf('p%d', k), {k});
+            end
+        end
+    end
+end
+
+function traverse(f)
+    blocks = f.blocks;
+    for i = 1:length(blocks)
+        arrays = blocks{i}.dataArrays;
+        for j = 1:length(arrays)
+            arrays{j}.dimensions;
+        end
+    end
+
+    sections = f.sections;
+    for i = 1:length(sections)
+        subs = sections{i}.sections;
+        for j = 1:length(subs)
+            subs{j}.allProperties;
+        end
+    end
+end
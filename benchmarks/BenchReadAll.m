@@ -0,0 +1,52 @@
+function BenchReadAll( n_runs )
+%BENCHREADALL compares DataArray.read_all with the former permute path
+%   Before the data was transposed on the c++ side, read_all returned
+%   the raw row-major data and reordered it with permute in MATLAB.
+%   The cost of that path is estimated as the time it takes to read a
+%   vector with the same number of elements (which needs no
+%   transposition at all) plus the time of the permute call.
+
+    if ~exist('n_runs', 'var')
+        n_runs = 5;
+    end
+
+    f = nix.File(fullfile(tempdir, 'nix_mx_bench_read.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('bench', 'nixBlock');
+
+    shapes = {[4096 4096], [64 1000000], [256 256 256], [32 2048 512]};
+
+    fprintf('%-18s %12s %12s %12s\n', 'shape', 'read_all', 'permute', 'old (est.)');
+    for i = 1:length(shapes)
+        shape = shapes{i};
+        data = rand(shape);
+        da = b.create_data_array(sprintf('nd%d', i), 'bench', 'double', shape);
+        da.write_range(data, ones(1, length(shape)));
+
+        vec = b.create_data_array(sprintf('vec%d', i), 'bench', 'double', numel(data));
+        vec.write_range(data(:)', 1);
+        clear data;
+
+        t_read = time_it(@() da.read_all(), n_runs);
+        t_vec = time_it(@() vec.read_all(), n_runs);
+
+        raw = reshape(vec.read_all(), fliplr(shape));
+        t_perm = time_it(@() permute(raw, length(shape):-1:1), n_runs);
+        clear raw;
+
+        fprintf('%-18s %10.3f s %10.3f s %10.3f s\n', mat2str(shape), ...
+            t_read, t_perm, t_vec + t_perm);
+
+        b.delete_data_array(da);
+        b.delete_data_array(vec);
+    end
+end
+
+function t = time_it(fn, n_runs)
+    t = inf;
+    for i = 1:n_runs
+        tic;
+        tmp = fn();
+        t = min(t, toc);
+        clear tmp;
+    end
+end
@@ -0,0 +1,42 @@
+function BenchReadBatch( n_runs )
+%BENCHREADBATCH reads many compressed DataArrays with File.read_batch,
+%   in this process and spread over reader processes (start_readers).
+
+    if ~exist('n_runs', 'var')
+        n_runs = 3;
+    end
+
+    fname = fullfile(tempdir, 'nix_mx_bench_batch.h5');
+    f = nix.File(fname, nix.FileMode.Overwrite);
+    b = f.createBlock('bench', 'nixBlock');
+
+    n_arrays = 32;
+    opts = struct('chunks', [64 16384], 'deflate', 4);
+    for i = 1:n_arrays
+        b.create_data_array_from_data(sprintf('da%d', i), 'bench', ...
+            cumsum(randn(64, 200000), 2), opts);
+    end
+    clear b f;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly);
+    das = f.blocks{1}.dataArrays;
+
+    fprintf('%-12s %12s\n', 'processes', 'read_batch');
+    fprintf('%-12s %10.3f s\n', 'none', time_it(@() f.read_batch(das), n_runs));
+
+    for n = [1 2 4 8]
+        f.start_readers(n);
+        fprintf('%-12d %10.3f s\n', n, time_it(@() f.read_batch(das), n_runs));
+    end
+    f.stop_readers();
+end
+
+function t = time_it(fn, n_runs)
+    t = inf;
+    for i = 1:n_runs
+        tic;
+        tmp = fn();
+        t = min(t, toc);
+        clear tmp;
+    end
+end
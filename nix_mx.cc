@@ -7,6 +7,7 @@
 #include "arguments.h"
 #include "struct.h"
 #include "mknix.h"
+#include "h5util.h"
 
 #include "nixfile.h"
 #include "nixsection.h"
@@ -18,6 +19,7 @@
 #include "nixtag.h"
 #include "nixmultitag.h"
 #include "nixdimensions.h"
+#include "nixcursor.h"
 
 #include <utils/glue.h>
 
@@ -28,7 +30,39 @@
 static void entity_destroy(const extractor &input, infusor &output)
 {
     handle h = input.hdl(1);
+
+    if (h.the_entity()->id == entity_to_id<nix::File>::value) {
+        const std::string location = h.get<nix::File>().location();
+        const uint64_t address = h.address();
+        h.destroy();
+        //appends end with the file, before its pinned open goes
+        nixdataarray::release_file(location);
+        nixfile::release(address);
+        return;
+    }
+
+    if (h.the_entity()->id != entity_to_id<nix::DataArray>::value) {
+        h.destroy();
+        return;
+    }
+
+    //the handle goes away even if a queued write has failed
+    const uint64_t address = h.address();
     h.destroy();
+
+    //stop read-ahead and write what is queued
+    nixdataarray::release(address);
+}
+
+//the file of the handle a command runs on, empty if it takes none
+static std::string subject_file(const extractor &input)
+{
+    if (input.check_size(1) || input.class_id(1) != mxUINT64_CLASS) {
+        return std::string();
+    }
+
+    handle h = input.hdl(1);
+    return h.address() != 0 ? h.file() : std::string();
 }
 
 static void entity_updated_at(const extractor &input, infusor &output)
@@ -50,6 +84,14 @@ static void on_exit() {
     mexPrintf("[GLUE] deleting handlers!\n");
 #endif
 
+    try {
+        std::lock_guard<std::timed_mutex> lock(h5_mutex());
+        nixdataarray::release_all();
+        nixfile::release_all();
+    } catch (const std::exception &e) {
+        mexPrintf("[nix-mx] could not release DataArrays: %s\n", e.what());
+    }
+
     delete methods;
 }
 
@@ -92,6 +134,11 @@ void mexFunction(int            nlhs,
         classdef<nix::File>("File", methods)
             .desc(&nixfile::describe)
             .add("open", nixfile::open)
+            .add("flush", nixfile::flush)
+            .add("startReaders", nixfile::start_readers)
+            .add("stopReaders", nixfile::stop_readers)
+            .add("removeSharedCache", nixfile::remove_shared_cache)
+            .add("readBatch", nixdataarray::read_batch)
             .reg("blocks", GETTER(std::vector<nix::Block>, nix::File, blocks))
             .reg("sections", GETTER(std::vector<nix::Section>, nix::File, sections))
             .reg("deleteBlock", REMOVER(nix::Block, nix::File, deleteBlock))
@@ -141,6 +188,10 @@ void mexFunction(int            nlhs,
             .reg("set_none_label", SETTER(const boost::none_t, nix::DataArray, label))
             .reg("set_unit", SETTER(const std::string&, nix::DataArray, unit))
             .reg("set_none_unit", SETTER(const boost::none_t, nix::DataArray, unit))
+            .reg("set_polynom_coefficients", SETTER(const std::vector<double>&, nix::DataArray, polynomCoefficients))
+            .reg("set_none_polynom_coefficients", SETTER(const boost::none_t, nix::DataArray, polynomCoefficients))
+            .reg("set_expansionOrigin", SETTER(double, nix::DataArray, expansionOrigin))
+            .reg("set_none_expansionOrigin", SETTER(const boost::none_t, nix::DataArray, expansionOrigin))
             .reg("dimensions", FILTER(std::vector<nix::Dimension>, nix::DataArray, , dimensions))
             .reg("append_set_dimension", &nix::DataArray::appendSetDimension)
             .reg("append_range_dimension", &nix::DataArray::appendRangeDimension)
@@ -151,6 +202,29 @@ void mexFunction(int            nlhs,
         methods->add("DataArray::delete_dimension", nixdataarray::delete_dimension);
         methods->add("DataArray::readAll", nixdataarray::read_all);
         methods->add("DataArray::writeAll", nixdataarray::write_all);
+        methods->add("DataArray::writeQuantized", nixdataarray::write_quantized);
+        methods->add("DataArray::readRange", nixdataarray::read_range);
+        methods->add("DataArray::readInto", nixdataarray::read_into);
+        methods->add("DataArray::readIndexed", nixdataarray::read_indexed);
+        methods->add("DataArray::readPoints", nixdataarray::read_points);
+        methods->add("DataArray::readStrided", nixdataarray::read_strided);
+        methods->add("DataArray::readCalibrated", nixdataarray::read_calibrated);
+        methods->add("DataArray::reduce", nixdataarray::reduce);
+        methods->add("DataArray::buildZoneMap", nixdataarray::build_zone_map);
+        methods->add("DataArray::dropZoneMap", nixdataarray::drop_zone_map);
+        methods->add("DataArray::findRange", nixdataarray::find_range);
+        methods->add("DataArray::buildEnvelope", nixdataarray::build_envelope);
+        methods->add("DataArray::dropEnvelope", nixdataarray::drop_envelope);
+        methods->add("DataArray::readEnvelope", nixdataarray::read_envelope);
+        methods->add("DataArray::openCursor", nixdataarray::open_cursor);
+        methods->add("DataArray::writeRange", nixdataarray::write_range);
+        methods->add("DataArray::appendData", nixdataarray::append_data);
+        methods->add("DataArray::finishAppend", nixdataarray::finish_append);
+        methods->add("DataArray::setPrefetch", nixdataarray::set_prefetch);
+        methods->add("DataArray::setAsyncWrite", nixdataarray::set_async_write);
+        methods->add("DataArray::waitWrites", nixdataarray::wait_writes);
+        methods->add("DataArray::flushWrites", nixdataarray::flush_writes);
+        methods->add("DataArray::refresh", nixdataarray::refresh);
         methods->add("DataArray::addSource", nixdataarray::add_source);
         // REMOVER for DataArray.removeSource leads to an error, therefore use method->add for now
         methods->add("DataArray::removeSource", nixdataarray::remove_source);
@@ -188,6 +262,7 @@ void mexFunction(int            nlhs,
             .reg("removeSource", REMOVER(nix::Source, nix::Tag, removeSource))
             .reg("deleteFeature", REMOVER(nix::Feature, nix::Tag, deleteFeature));
         methods->add("Tag::retrieveData", nixtag::retrieve_data);
+        methods->add("Tag::retrieveDataInto", nixtag::retrieve_data_into);
         methods->add("Tag::featureRetrieveData", nixtag::retrieve_feature_data);
         methods->add("Tag::addReference", nixtag::add_reference);
         methods->add("Tag::addSource", nixtag::add_source);
@@ -211,6 +286,7 @@ void mexFunction(int            nlhs,
             .reg("removeSource", REMOVER(nix::Source, nix::MultiTag, removeSource))
             .reg("deleteFeature", REMOVER(nix::Feature, nix::MultiTag, deleteFeature));
         methods->add("MultiTag::retrieveData", nixmultitag::retrieve_data);
+        methods->add("MultiTag::retrieveDataInto", nixmultitag::retrieve_data_into);
         methods->add("MultiTag::featureRetrieveData", nixmultitag::retrieve_feature_data);
         methods->add("MultiTag::addReference", nixmultitag::add_reference);
         methods->add("MultiTag::addSource", nixmultitag::add_source);
@@ -287,12 +363,26 @@ void mexFunction(int            nlhs,
             .reg("tick_at", &nix::RangeDimension::tickAt)
             .reg("axis", &nix::RangeDimension::axis);
 
+        classdef<data_cursor>("Cursor", methods)
+            .desc(&nixcursor::describe)
+            .add("hasNext", nixcursor::has_next)
+            .add("next", nixcursor::next)
+            .add("reset", nixcursor::reset);
+
         mexAtExit(on_exit);
     });
 
     bool processed = false;
 
     try {
+        //background threads may only use HDF5 in between commands
+        std::lock_guard<std::timed_mutex> lock(h5_mutex());
+
+        //DataArrays are looked up in the file their handle comes from,
+        // ids may repeat in other open files
+        handle::current_file() = subject_file(input);
+        h5_file_scope scope(handle::current_file());
+
         processed = methods->dispatch(cmd, input, output);
 
 #ifdef DEBUG_GLUE
@@ -0,0 +1,206 @@
+// nix_mx_reader: reads blocks of datasets for nix_mx, see readerpool.h
+//   nix_mx_reader <file> <socket fd> <shared memory name> <bytes> <swmr>
+
+#include "readerproto.h"
+
+#include <hdf5.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static bool send_all(int sock, const void *data, size_t n)
+{
+    const char *p = static_cast<const char *>(data);
+
+    while (n > 0) {
+        const ssize_t res = ::send(sock, p, n, 0);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        n -= static_cast<size_t>(res);
+    }
+
+    return true;
+}
+
+static bool recv_all(int sock, void *data, size_t n)
+{
+    char *p = static_cast<char *>(data);
+
+    while (n > 0) {
+        const ssize_t res = ::recv(sock, p, n, 0);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        n -= static_cast<size_t>(res);
+    }
+
+    return true;
+}
+
+static bool reply(int sock, int32_t status, uint64_t nbytes, const std::string &msg = std::string())
+{
+    reader_reply r;
+    r.status = status;
+    r.msg_bytes = static_cast<uint32_t>(msg.size());
+    r.nbytes = nbytes;
+
+    return send_all(sock, &r, sizeof(r)) && send_all(sock, msg.data(), msg.size());
+}
+
+static hid_t mem_type(reader_type type, hid_t dset)
+{
+    switch (type) {
+    case reader_type::int8: return H5Tcopy(H5T_NATIVE_INT8);
+    case reader_type::uint8: return H5Tcopy(H5T_NATIVE_UINT8);
+    case reader_type::int16: return H5Tcopy(H5T_NATIVE_INT16);
+    case reader_type::uint16: return H5Tcopy(H5T_NATIVE_UINT16);
+    case reader_type::int32: return H5Tcopy(H5T_NATIVE_INT32);
+    case reader_type::uint32: return H5Tcopy(H5T_NATIVE_UINT32);
+    case reader_type::int64: return H5Tcopy(H5T_NATIVE_INT64);
+    case reader_type::uint64: return H5Tcopy(H5T_NATIVE_UINT64);
+    case reader_type::float32: return H5Tcopy(H5T_NATIVE_FLOAT);
+    case reader_type::float64: return H5Tcopy(H5T_NATIVE_DOUBLE);
+    case reader_type::stored: return H5Dget_type(dset);
+    }
+    return -1;
+}
+
+//reads the block into buf, returns an error message or ""
+static std::string read_block(hid_t dset, reader_type type, const std::vector<hsize_t> &offset,
+                              const std::vector<hsize_t> &count, void *buf, size_t capacity,
+                              uint64_t &nbytes)
+{
+    hid_t memtype = mem_type(type, dset);
+    if (memtype < 0) {
+        return "unsupported data type";
+    }
+
+    nbytes = H5Tget_size(memtype);
+    for (hsize_t n : count) {
+        nbytes *= n;
+    }
+
+    std::string error;
+    if (nbytes > capacity) {
+        error = "block exceeds the shared memory";
+    } else {
+        hid_t fspace = H5Dget_space(dset);
+        hid_t mspace = H5Screate_simple(static_cast<int>(count.size()), count.data(), nullptr);
+
+        if (H5Sselect_hyperslab(fspace, H5S_SELECT_SET, offset.data(), nullptr, count.data(), nullptr) < 0 ||
+            H5Dread(dset, memtype, mspace, fspace, H5P_DEFAULT, buf) < 0) {
+            error = "could not read the selection";
+        }
+
+        H5Sclose(mspace);
+        H5Sclose(fspace);
+    }
+
+    H5Tclose(memtype);
+    return error;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 6) {
+        return 2;
+    }
+
+    const int sock = atoi(argv[2]);
+    const size_t capacity = static_cast<size_t>(strtoull(argv[4], nullptr, 10));
+    const bool swmr = argv[5][0] == '1';
+
+    //errors are reported to nix_mx
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+    const int shm = shm_open(argv[3], O_RDWR, 0600);
+    void *buf = shm < 0 ? MAP_FAILED : mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    if (shm >= 0) {
+        close(shm);
+    }
+
+    if (buf == MAP_FAILED) {
+        reply(sock, -1, 0, "could not map the shared memory");
+        return 1;
+    }
+
+    unsigned int flags = H5F_ACC_RDONLY;
+#ifdef H5F_ACC_SWMR_READ
+    if (swmr) {
+        flags |= H5F_ACC_SWMR_READ;
+    }
+#endif
+
+    hid_t file = H5Fopen(argv[1], flags, H5P_DEFAULT);
+    if (file < 0) {
+        reply(sock, -1, 0, std::string("could not open ") + argv[1]);
+        return 1;
+    }
+
+    if (!reply(sock, 0, 0)) {
+        return 1;
+    }
+
+    std::map<std::string, hid_t> datasets;
+    reader_request req;
+
+    //until nix_mx closes the socket
+    while (recv_all(sock, &req, sizeof(req))) {
+        std::string path(req.path_bytes, '\0');
+        std::vector<uint64_t> sel(2 * req.rank);
+
+        if ((req.path_bytes > 0 && !recv_all(sock, &path[0], path.size())) ||
+            !recv_all(sock, sel.data(), sel.size() * sizeof(uint64_t))) {
+            break;
+        }
+
+        std::vector<hsize_t> offset(sel.begin(), sel.begin() + req.rank);
+        std::vector<hsize_t> count(sel.begin() + req.rank, sel.end());
+
+        hid_t &dset = datasets[path];
+        if (dset <= 0) {
+            dset = H5Dopen2(file, path.c_str(), H5P_DEFAULT);
+        }
+#if H5_VERSION_GE(1, 10, 0)
+        else if (swmr) {
+            //the writer may have appended
+            H5Drefresh(dset);
+        }
+#endif
+
+        uint64_t nbytes = 0;
+        const std::string error = dset < 0 ? "could not open " + path :
+            read_block(dset, static_cast<reader_type>(req.type), offset, count, buf, capacity, nbytes);
+
+        if (dset < 0) {
+            datasets.erase(path);
+        }
+
+        if (!reply(sock, error.empty() ? 0 : -1, nbytes, error)) {
+            break;
+        }
+    }
+
+    for (auto &kv : datasets) {
+        H5Dclose(kv.second);
+    }
+    H5Fclose(file);
+    munmap(buf, capacity);
+    return 0;
+}
@@ -7,6 +7,10 @@
 #include "handle.h"
 #include "arguments.h"
 #include "struct.h"
+#include "nixdataarray.h"
+#include "h5util.h"
+
+#include <algorithm>
 
 namespace nixblock {
 
@@ -31,7 +35,51 @@ namespace nixblock {
         nix::DataType dtype = nix::string_to_data_type(input.str(4));
         nix::NDSize size = input.ndsize(5);
 
+        //column-major arrays keep the matlab memory layout on disk,
+        // i.e. they are stored with the dimensions reversed
+        const bool colmajor = input.has_field(6, "storage") &&
+            input.field_str(6, "storage") == "column-major";
+
+        if (colmajor) {
+            std::reverse(size.begin(), size.end());
+        }
+
         nix::DataArray dt = block.createDataArray(name, type, dtype, size);
+
+        if (colmajor) {
+            nixdataarray::set_column_major(dt);
+        }
+
+        //NIX has no say in the storage layout, the dataset is
+        // replaced while it is still empty
+        if (input.has_field(6, "chunks") || input.has_field(6, "deflate") ||
+            input.has_field(6, "shuffle") || input.has_field(6, "fill") ||
+            input.has_field(6, "contiguous")) {
+            h5_layout layout;
+
+            if (input.has_field(6, "chunks")) {
+                layout.chunks = input.field_ndsize(6, "chunks");
+                if (colmajor) {
+                    std::reverse(layout.chunks.begin(), layout.chunks.end());
+                }
+            }
+
+            if (input.has_field(6, "deflate")) {
+                layout.deflate = static_cast<int>(input.field_num(6, "deflate"));
+            }
+
+            layout.shuffle = input.has_field(6, "shuffle") && input.field_bool(6, "shuffle");
+            layout.fill = input.has_field(6, "fill") ? input.field_num(6, "fill") : 0;
+            layout.contiguous = input.has_field(6, "contiguous") && input.field_bool(6, "contiguous");
+
+            try {
+                h5_set_layout(dt, layout);
+            } catch (...) {
+                block.deleteDataArray(dt.id());
+                throw;
+            }
+        }
+
         output.set(0, dt);
     }
 
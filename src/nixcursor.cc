@@ -0,0 +1,48 @@
+#include "nixcursor.h"
+
+#include "mex.h"
+
+#include <nix.hpp>
+
+#include "handle.h"
+#include "arguments.h"
+#include "struct.h"
+
+namespace nixcursor {
+
+    mxArray *describe(const data_cursor &cursor)
+    {
+        struct_builder sb({ 1 }, { "shape", "blockShape" });
+        sb.set(cursor.extent());
+        sb.set(cursor.block());
+        return sb.array();
+    }
+
+    void has_next(const extractor &input, infusor &output)
+    {
+        data_cursor cursor = input.entity<data_cursor>(1);
+        output.set(0, cursor.has_next());
+    }
+
+    void next(const extractor &input, infusor &output)
+    {
+        data_cursor cursor = input.entity<data_cursor>(1);
+
+        nix::NDSize offset;
+        mxArray *data = cursor.next(offset);
+
+        output.set(0, data);
+
+        //check_size is true if the position is out of bounds
+        if (!output.check_size(1)) {
+            output.set(1, offset);
+        }
+    }
+
+    void reset(const extractor &input, infusor &output)
+    {
+        data_cursor cursor = input.entity<data_cursor>(1);
+        cursor.reset();
+    }
+
+} // namespace nixcursor
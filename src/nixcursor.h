@@ -0,0 +1,19 @@
+#ifndef NIX_MX_CURSOR
+#define NIX_MX_CURSOR
+
+#include "arguments.h"
+#include "cursor.h"
+
+namespace nixcursor {
+
+    mxArray *describe(const data_cursor &cursor);
+
+    void has_next(const extractor &input, infusor &output);
+
+    void next(const extractor &input, infusor &output);
+
+    void reset(const extractor &input, infusor &output);
+
+} // namespace nixcursor
+
+#endif
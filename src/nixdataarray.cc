@@ -8,22 +8,708 @@
 #include "arguments.h"
 #include "struct.h"
 #include "mknix.h"
+#include "h5util.h"
+#include "h5select.h"
+#include "transpose.h"
+#include "cursor.h"
+#include "prefetch.h"
+#include "writer.h"
+#include "chunkread.h"
+#include "chunkwrite.h"
+#include "mmapread.h"
+#include "calibrate.h"
+#include "reduce.h"
+#include "zonemap.h"
+#include "envelope.h"
+#include "readerpool.h"
+#include "nixfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <thread>
 
 namespace nixdataarray {
 
+    static const char *storage_attr = "storage_order";
+
+    static nix::NDSize reversed(const nix::NDSize &size)
+    {
+        nix::NDSize res = size;
+        std::reverse(res.begin(), res.end());
+        return res;
+    }
+
+    //stored values read or written at once by read_calibrated and
+    // write_quantized
+    static const size_t calibrate_block_bytes = 1 << 20;
+
+    //strides of a matlab array of the given shape along the axes of the file
+    static std::vector<size_t> file_strides(const nix::NDSize &shape, bool colmajor)
+    {
+        std::vector<size_t> strides = colmajor_strides(shape);
+        if (colmajor) {
+            std::reverse(strides.begin(), strides.end());
+        }
+        return strides;
+    }
+
+    bool is_column_major(const nix::DataArray &da)
+    {
+        h5_id group = h5_open_group(da);
+        return h5_has_attr(group.get(), storage_attr) &&
+            h5_read_str_attr(group.get(), storage_attr) == "column-major";
+    }
+
+    void set_column_major(const nix::DataArray &da)
+    {
+        h5_id group = h5_open_group(da);
+        h5_write_str_attr(group.get(), storage_attr, "column-major");
+    }
+
+    // *** appending ***
+
+    /*
+      Appends grow the dataset in multiples of its chunk size along
+      the append axis, so that most of them only write data. The part
+      of the allocation that holds no data yet is tracked here, hidden
+      from reads and cut off again by trim_append, when the session
+      is finished or the file released; a session outlives the handles
+      of the DataArray, so temporary ones do not end it. Sessions are
+      kept per (file, id), a copy of the file has the same ids.
+    */
+    struct append_state {
+        nix::DataArray da;
+        nix::NDSize allocated; //extent of the dataset, file order
+        nix::NDSize filled;    //extent holding data, file order
+        bool colmajor;
+    };
+
+    typedef std::map<h5_entity_key, append_state> append_map;
+    static append_map appends;
+
+    //default number of chunks the dataset grows by at once
+    static const double default_growth = 4;
+
+    //the append session of the DataArray, if any
+    static append_map::iterator find_append(const nix::DataArray &da)
+    {
+        if (appends.empty()) {
+            return appends.end();
+        }
+
+        try {
+            return appends.find(h5_key_of(da));
+        } catch (const std::runtime_error &) {
+            //sessions are only started for DataArrays we can locate
+            return appends.end();
+        }
+    }
+
+    //extent of the data in the file, excluding pre-allocated space
+    static nix::NDSize file_extent(const nix::DataArray &da)
+    {
+        nix::NDSize extent = da.dataExtent();
+
+        auto it = find_append(da);
+        if (it == appends.end()) {
+            return extent;
+        }
+
+        //someone else changed the extent, the session is void
+        if (it->second.allocated != extent) {
+            appends.erase(it);
+            return extent;
+        }
+
+        return it->second.filled;
+    }
+
+    static nix::NDSize logical_extent(const nix::DataArray &da, bool colmajor)
+    {
+        nix::NDSize extent = file_extent(da);
+        return colmajor ? reversed(extent) : extent;
+    }
+
+    static void trim_append(append_map::iterator it)
+    {
+        append_state state = it->second;
+        appends.erase(it);
+
+        if (state.da.dataExtent() == state.allocated) {
+            state.da.dataExtent(state.filled);
+        }
+    }
+
+    static void trim_append(const nix::DataArray &da)
+    {
+        auto it = find_append(da);
+        if (it != appends.end()) {
+            trim_append(it);
+        }
+    }
+
+    static void trim_all_appends()
+    {
+        while (!appends.empty()) {
+            trim_append(appends.begin());
+        }
+    }
+
+    //ends the session of the DataArray without trimming, for writes
+    // that set the extent themselves
+    static void drop_append(const nix::DataArray &da)
+    {
+        auto it = find_append(da);
+        if (it != appends.end()) {
+            appends.erase(it);
+        }
+    }
+
+    static void trim_appends_of(const std::string &file)
+    {
+        auto it = appends.begin();
+        while (it != appends.end()) {
+            auto next = std::next(it);
+            if (it->first.first == file) {
+                trim_append(it);
+            }
+            it = next;
+        }
+    }
+
+    //new allocated size along the append axis: the filled size rounded
+    // up to `growth` chunks; without chunking the dataset grows exactly
+    static nix::ndsize_t grow_to(const nix::DataArray &da, size_t axis, nix::ndsize_t needed, double growth)
+    {
+        nix::ndsize_t chunk = 0;
+
+        try {
+            h5_id dset = h5_open_data(da);
+            nix::NDSize chunks = h5_chunk_extent(dset.get());
+            if (axis < chunks.size()) {
+                chunk = chunks[axis];
+            }
+        } catch (const std::runtime_error &) {
+            chunk = 0;
+        }
+
+        const nix::ndsize_t quantum = static_cast<nix::ndsize_t>(chunk * growth);
+        if (quantum == 0) {
+            return needed;
+        }
+
+        return (needed + quantum - 1) / quantum * quantum;
+    }
+
+    //dimension descriptors along the append axis must describe the new data
+    static void extend_dimension(const nix::DataArray &da, size_t axis, nix::ndsize_t n, const extractor &input)
+    {
+        if (axis >= da.dimensionCount()) {
+            return;
+        }
+
+        nix::Dimension dim = da.getDimension(axis + 1);
+
+        if (dim.dimensionType() != nix::DimensionType::Range) {
+            //sampled and set dimensions hold for any number of entries
+            return;
+        }
+
+        if (!input.has_field(4, "ticks")) {
+            throw std::invalid_argument("appending along a range dimension requires ticks");
+        }
+
+        std::vector<double> added = input.field_vec<double>(4, "ticks");
+        if (added.size() != n) {
+            throw std::invalid_argument("the number of ticks must match the appended data");
+        }
+
+        nix::RangeDimension rd = dim.asRangeDimension();
+        std::vector<double> ticks = rd.ticks();
+        ticks.insert(ticks.end(), added.begin(), added.end());
+        rd.ticks(ticks);
+    }
+
+    //reads contiguous data from a mapping of the file, false if the
+    // dataset or the file are not suited for that
+    static bool fill_mapped(const nix::DataArray &da, bool colmajor, mxArray *data,
+                            const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        DType2 dtype = dtype_nix2mex(da.dataType());
+        if (!dtype.is_valid || count.nelms() == 0) {
+            return false;
+        }
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        if (!h5_mappable(dset.get(), memtype.get())) {
+            return false;
+        }
+
+        check_mx_buffer(data, dtype, count);
+
+        const size_t elsize = nix::data_type_to_size(da.dataType());
+        return h5_read_mapped(dset.get(), elsize, colmajor ? reversed(offset) : offset,
+                              colmajor ? reversed(count) : count, mxGetData(data),
+                              file_strides(count, colmajor));
+    }
+
+    //reads through the shared chunk cache of the file, false if it
+    // was opened without one or the dataset is not suited for it
+    static bool fill_cached(const nix::DataArray &da, bool colmajor, mxArray *data,
+                            const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        std::string file_key;
+        shared_chunk_cache *cache = nixfile::shared_cache_of(da, file_key);
+        if (cache == nullptr || count.nelms() == 0) {
+            return false;
+        }
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        if (!h5_decodable_chunks(dset.get(), memtype.get())) {
+            return false;
+        }
+
+        check_mx_buffer(data, dtype_nix2mex(da.dataType()), count);
+
+        const size_t elsize = nix::data_type_to_size(da.dataType());
+        h5_read_chunks_cached(dset.get(), memtype.get(), elsize, colmajor ? reversed(offset) : offset,
+                              colmajor ? reversed(count) : count, mxGetData(data),
+                              file_strides(count, colmajor), *cache, file_key + h5_path_of(dset.get()));
+        return true;
+    }
+
+    //count and offset are given in the order of the matlab dimensions
+    static void fill_data(const nix::DataArray &da, bool colmajor, mxArray *data,
+                          const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        if (fill_mapped(da, colmajor, data, count, offset) || fill_cached(da, colmajor, data, count, offset)) {
+            return;
+        }
+
+        if (!colmajor) {
+            fill_mx_array_from_ds(da, data, count, offset);
+            return;
+        }
+
+        //column-major data is stored with the extent reversed,
+        // which is exactly the memory layout matlab expects
+        nix::DataType da_type = da.dataType();
+        check_mx_buffer(data, dtype_nix2mex(da_type), count);
+
+        if (count.nelms() > 0) {
+            da.getData(da_type, mxGetData(data), reversed(count), reversed(offset));
+        }
+    }
+
+    static mxArray *make_result(const nix::DataArray &da, const nix::NDSize &shape)
+    {
+        DType2 dtype = dtype_nix2mex(da.dataType());
+
+        if (!dtype.is_valid) {
+            throw std::domain_error("Unsupported data type");
+        }
+
+        return make_mx_array_uninitialized(shape, dtype);
+    }
+
+    static mxArray *read_data(const nix::DataArray &da, bool colmajor,
+                              const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        mxArray *data = make_result(da, count);
+
+        try {
+            fill_data(da, colmajor, data, count, offset);
+        } catch (...) {
+            mxDestroyArray(data);
+            throw;
+        }
+
+        return data;
+    }
+
+    //reads compressed data by inflating the chunks in parallel,
+    // false if the dataset is not suited for that
+    static bool fill_parallel(const nix::DataArray &da, bool colmajor, mxArray *data,
+                              const nix::NDSize &count)
+    {
+        const size_t threads = std::thread::hardware_concurrency();
+        std::string file_key;
+        if (threads < 2 || count.nelms() == 0 || nixfile::shared_cache_of(da, file_key) != nullptr) {
+            return false;
+        }
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        if (!h5_direct_chunks(dset.get(), memtype.get())) {
+            return false;
+        }
+
+        check_mx_buffer(data, dtype_nix2mex(da.dataType()), count);
+
+        const size_t elsize = nix::data_type_to_size(da.dataType());
+        h5_read_chunks_parallel(dset.get(), memtype.get(), elsize, colmajor ? reversed(count) : count,
+                                mxGetData(data), file_strides(count, colmajor), threads);
+        return true;
+    }
+
+    // *** read-ahead ***
+
+    struct prefetch_entry {
+        std::string id;
+        std::unique_ptr<prefetcher> pf;
+    };
+
+    //per handle, so that every matlab object scans on its own
+    static std::map<uint64_t, prefetch_entry> prefetchers;
+
+    //default bound of the read-ahead buffer
+    static const double default_prefetch_bytes = 64 << 20;
+
+    //after writes, what has been read ahead may be stale
+    static void discard_prefetched(const nix::DataArray &da)
+    {
+        const std::string id = da.id();
+        for (auto &kv : prefetchers) {
+            if (kv.second.id == id) {
+                kv.second.pf->discard();
+            }
+        }
+    }
+
+    //like fill_data, but takes the data from the read-ahead buffer
+    // of the handle if it is there and starts reading the next block
+    static void fill_prefetched(const handle &h, const nix::DataArray &da, bool colmajor, mxArray *data,
+                                const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        auto it = prefetchers.find(h.address());
+        if (it == prefetchers.end()) {
+            fill_data(da, colmajor, data, count, offset);
+            return;
+        }
+
+        prefetcher &pf = *it->second.pf;
+        check_mx_buffer(data, dtype_nix2mex(da.dataType()), count);
+
+        nix::NDSize f_count = colmajor ? reversed(count) : count;
+        nix::NDSize f_offset = colmajor ? reversed(offset) : offset;
+
+        if (!pf.take(f_offset, f_count, mxGetData(data), file_strides(count, colmajor))) {
+            fill_data(da, colmajor, data, count, offset);
+        }
+
+        pf.observed(f_offset, f_count, file_extent(da));
+    }
+
+    void set_prefetch(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        const uint64_t key = input.hdl(1).address();
+
+        //stops the worker of a previous setting
+        prefetchers.erase(key);
+
+        if (!input.logical(2)) {
+            return;
+        }
+
+        const double max_bytes = input.has_field(3, "maxBytes") ?
+            input.field_num(3, "maxBytes") : default_prefetch_bytes;
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        const size_t elsize = nix::data_type_to_size(da.dataType());
+
+        prefetch_entry entry { da.id(), std::unique_ptr<prefetcher>(
+            new prefetcher(std::move(dset), std::move(memtype), elsize, static_cast<size_t>(max_bytes))) };
+        prefetchers.emplace(key, std::move(entry));
+    }
+
+    // *** write-behind ***
+
+    struct writer_entry {
+        std::string id;
+        std::unique_ptr<write_queue> wq;
+    };
+
+    //per handle like the read-ahead; reads and synchronous writes
+    // of any handle wait for the queues of the DataArray
+    static std::map<uint64_t, writer_entry> writers;
+
+    //default bound of the data waiting to be written
+    static const double default_queue_bytes = 256 << 20;
+
+    static write_queue *async_writer(const handle &h)
+    {
+        auto it = writers.find(h.address());
+        return it != writers.end() ? it->second.wq.get() : nullptr;
+    }
+
+    //waits for the queued writes of the DataArray, throws their errors
+    static void settle(const nix::DataArray &da)
+    {
+        const std::string id = da.id();
+        for (auto &kv : writers) {
+            if (kv.second.id == id) {
+                kv.second.wq->wait();
+            }
+        }
+    }
+
+    void set_async_write(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        const uint64_t key = input.hdl(1).address();
+
+        //a previous queue is drained first, its errors are reported
+        auto it = writers.find(key);
+        if (it != writers.end()) {
+            std::unique_ptr<write_queue> wq = std::move(it->second.wq);
+            writers.erase(it);
+            wq->wait();
+        }
+
+        if (!input.logical(2)) {
+            return;
+        }
+
+        const double max_bytes = input.has_field(3, "maxBytes") ?
+            input.field_num(3, "maxBytes") : default_queue_bytes;
+
+        writer_entry entry { da.id(), std::unique_ptr<write_queue>(
+            new write_queue(h5_open_data(da), static_cast<size_t>(max_bytes))) };
+        writers.emplace(key, std::move(entry));
+    }
+
+    void wait_all()
+    {
+        for (auto &kv : writers) {
+            kv.second.wq->wait();
+        }
+    }
+
+    void wait_writes(const extractor &input, infusor &output)
+    {
+        settle(input.entity<nix::DataArray>(1));
+    }
+
+    void flush_writes(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+
+        h5_id dset = h5_open_data(da);
+        h5_flush_file(dset.get());
+    }
+
+    //writes compressed data by filtering the chunks in parallel,
+    // false if the dataset is not suited for that
+    static bool store_parallel(const nix::DataArray &da, nix::DataType dtype,
+                               const void *data, const nix::NDSize &count)
+    {
+        const size_t threads = std::thread::hardware_concurrency();
+        if (threads < 2 || count.nelms() == 0) {
+            return false;
+        }
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), dtype);
+        if (!h5_direct_chunks(dset.get(), memtype.get())) {
+            return false;
+        }
+
+        h5_write_chunks_parallel(dset.get(), memtype.get(), nix::data_type_to_size(dtype), count, data, threads);
+        return true;
+    }
+
+    //writes now or queues the write if the handle writes behind;
+    // count and offset are in file order
+    static void store(const handle &h, nix::DataArray &da, nix::DataType dtype,
+                      const void *data, const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        discard_prefetched(da);
+
+        write_queue *wq = async_writer(h);
+        if (wq != nullptr) {
+            wq->push(dtype, data, offset, count);
+            return;
+        }
+
+        settle(da);
+        da.setData(dtype, data, count, offset);
+    }
+
+    // *** zone maps ***
+
+    //whether a DataArray has a zone map, by (file, id)
+    static std::map<h5_entity_key, bool> zoned;
+
+    static bool has_zone_map(const nix::DataArray &da)
+    {
+        const h5_entity_key key = h5_key_of(da);
+        auto it = zoned.find(key);
+        if (it != zoned.end()) {
+            return it->second;
+        }
+
+        h5_id group = h5_open_group(da);
+        return zoned[key] = h5_has_zone_map(group.get());
+    }
+
+    //forgets what is known about the DataArrays of a file
+    template<typename T>
+    static void forget_file(std::map<h5_entity_key, T> &known, const std::string &file)
+    {
+        auto it = known.begin();
+        while (it != known.end()) {
+            it = it->first.first == file ? known.erase(it) : std::next(it);
+        }
+    }
+
+    //brings the zone map in line with a write of count at offset; the
+    // data extended from previous to extent, all in file order
+    static void update_zones(const nix::DataArray &da, nix::DataType dtype, const void *data,
+                             const nix::NDSize &count, const nix::NDSize &offset,
+                             const nix::NDSize &previous, const nix::NDSize &extent)
+    {
+        if (!has_zone_map(da)) {
+            return;
+        }
+
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        h5_update_zones(group.get(), dset.get(), da.dataType(), dtype, data, offset, count, previous, extent);
+    }
+
+    // *** envelopes ***
+
+    //whether a DataArray has an envelope, by (file, id)
+    static std::map<h5_entity_key, bool> enveloped;
+
+    //values read at once to build an envelope
+    static const size_t envelope_block_bytes = 1 << 22;
+
+    static bool has_envelope(const nix::DataArray &da)
+    {
+        const h5_entity_key key = h5_key_of(da);
+        auto it = enveloped.find(key);
+        if (it != enveloped.end()) {
+            return it->second;
+        }
+
+        h5_id group = h5_open_group(da);
+        return enveloped[key] = h5_has_envelope(group.get());
+    }
+
+    //recomputes the envelope of the data within extent (file order)
+    // after it has been replaced
+    static void rebuild_envelope(const nix::DataArray &da, const nix::NDSize &extent)
+    {
+        if (!has_envelope(da)) {
+            return;
+        }
+
+        settle(da);
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        h5_build_envelope(group.get(), dset.get(), da.dataType(), extent,
+                          h5_envelope_axis(group.get()), envelope_block_bytes);
+    }
+
+    //recomputes the envelope over the block at offset that has been
+    // written
+    static void refresh_envelope(const nix::DataArray &da, const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        if (!has_envelope(da)) {
+            return;
+        }
+
+        settle(da);
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        const size_t axis = h5_envelope_axis(group.get());
+        h5_refresh_envelope(group.get(), dset.get(), da.dataType(), file_extent(da),
+                            offset[axis], offset[axis] + count[axis], envelope_block_bytes);
+    }
+
+    void release(uint64_t address)
+    {
+        prefetchers.erase(address);
+
+        auto it = writers.find(address);
+        if (it != writers.end()) {
+            std::unique_ptr<write_queue> wq = std::move(it->second.wq);
+            writers.erase(it);
+            wq->wait();
+        }
+    }
+
+    void release_file(const std::string &file)
+    {
+        trim_appends_of(file);
+        //other programs may change the file until it is opened again
+        forget_file(zoned, file);
+        forget_file(enveloped, file);
+    }
+
+    void release_all()
+    {
+        prefetchers.clear();
+        //what is still queued is written before the queues stop
+        writers.clear();
+        trim_all_appends();
+        zoned.clear();
+        enveloped.clear();
+    }
+
+    static void check_selection(const nix::NDSize &extent, const nix::NDSize &count, const nix::NDSize &offset)
+    {
+        if (count.size() != extent.size() || offset.size() != extent.size()) {
+            throw std::invalid_argument("offset and count must match the rank of the DataArray");
+        }
+
+        for (size_t i = 0; i < extent.size(); i++) {
+            if (offset[i] + count[i] > extent[i]) {
+                throw std::out_of_range("selection exceeds the extent of the DataArray");
+            }
+        }
+    }
+
     mxArray *describe(const nix::DataArray &da)
     {
         struct_builder sb({ 1 }, { "id", "type", "name", "definition", "label",
-            "shape", "unit", "polynom_coefficients" });
+            "shape", "unit", "polynom_coefficients", "expansionOrigin", "storage", "chunks",
+            "deflate", "shuffle", "fill" });
+
+        bool colmajor = false;
+        h5_layout layout;
+        try {
+            colmajor = is_column_major(da);
+            h5_id dset = h5_open_data(da);
+            layout = h5_get_layout(dset.get());
+        } catch (const std::runtime_error &) {
+            //not in a file we can see, report the defaults
+        }
 
         sb.set(da.id());
         sb.set(da.type());
         sb.set(da.name());
         sb.set(da.definition());
         sb.set(da.label());
-        sb.set(da.dataExtent());
+        sb.set(logical_extent(da, colmajor));
         sb.set(da.unit());
         sb.set(da.polynomCoefficients());
+        sb.set(da.expansionOrigin());
+        sb.set(colmajor ? "column-major" : "row-major");
+        sb.set(colmajor ? reversed(layout.chunks) : layout.chunks);
+        sb.set(static_cast<double>(layout.deflate));
+        sb.set(layout.shuffle);
+        sb.set(layout.fill);
 
         return sb.array();
     }
@@ -42,23 +728,815 @@ namespace nixdataarray {
 
     void read_all(const extractor &input, infusor &output)
     {
-        //nix::DataArray da = input.entity<nix::DataArray>(1);
-
         nix::DataArray da = input.entity<nix::DataArray>(1);
-        mxArray *data = make_mx_array_from_ds(da);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        nix::NDSize extent = logical_extent(da, colmajor);
+        nix::NDSize offset(extent.size(), 0);
+
+        mxArray *data = make_result(da, extent);
+
+        try {
+            if (!fill_parallel(da, colmajor, data, extent)) {
+                fill_data(da, colmajor, data, extent, offset);
+            }
+        } catch (...) {
+            mxDestroyArray(data);
+            throw;
+        }
+
         output.set(0, data);
     }
 
     void write_all(const extractor &input, infusor &output)
     {
         nix::DataArray da = input.entity<nix::DataArray>(1);
+        nix::NDSize extent = da.dataExtent();
+
+        //row-major data has been permuted by matlab, column-major
+        // data is passed as is; either way the reversed matlab
+        // dimensions are the extent in the file
+        nix::DataType dtype = input.dtype(2);
+        nix::NDSize count = input.extent(2, extent.size());
+        nix::NDSize offset(count.size(), 0);
+
+        //overwriting ends any pending append session
+        drop_append(da);
+
+        if (count != extent) {
+            //queued writes may lie outside of the new extent
+            settle(da);
+            da.dataExtent(count);
+        }
+
+        //a write-behind handle queues the data as is
+        if (async_writer(input.hdl(1)) == nullptr) {
+            settle(da);
+            discard_prefetched(da);
+
+            if (store_parallel(da, dtype, input.get_raw(2), count)) {
+                update_zones(da, dtype, input.get_raw(2), count, offset, offset, count);
+                rebuild_envelope(da, count);
+                return;
+            }
+        }
+
+        store(input.hdl(1), da, dtype, input.get_raw(2), count, offset);
+
+        //none of the previous values remain
+        update_zones(da, dtype, input.get_raw(2), count, offset, offset, count);
+        rebuild_envelope(da, count);
+    }
+
+    void write_quantized(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        nix::NDSize extent = da.dataExtent();
+
+        //laid out in file order like for write_all
+        nix::DataType in_type = input.dtype(2);
+        nix::NDSize count = input.extent(2, extent.size());
+        const double scale = input.num<double>(3);
+        const double offset = input.num<double>(4);
+
+        check_quantization(in_type, scale, offset, da.dataType());
+
+        drop_append(da);
+        settle(da);
+        discard_prefetched(da);
+
+        //the old data is gone once the extent changes
+        if (count != extent) {
+            da.dataExtent(count);
+        }
+
+        h5_id dset = h5_open_data(da);
+        const size_t clipped = h5_write_quantized(dset.get(), da.dataType(), in_type, input.get_raw(2),
+                                                  count, scale, offset, calibrate_block_bytes);
+
+        //the stored values are only known after quantization
+        if (has_zone_map(da)) {
+            h5_id group = h5_open_group(da);
+            h5_build_zone_map(group.get(), dset.get(), da.dataType(), count);
+        }
+        rebuild_envelope(da, count);
+
+        //read_calibrated and NIX give back offset + scale * q
+        std::vector<double> coefficients = { offset, scale };
+        da.polynomCoefficients(coefficients);
+        da.expansionOrigin(boost::none);
+
+        output.set(0, static_cast<double>(clipped));
+    }
+
+    void read_range(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        nix::NDSize offset = input.ndsize(2);
+        nix::NDSize count = input.ndsize(3);
+        check_selection(logical_extent(da, colmajor), count, offset);
+
+        mxArray *data = make_result(da, count);
+        fill_prefetched(input.hdl(1), da, colmajor, data, count, offset);
+        output.set(0, data);
+    }
+
+    //the type reader processes read dtype as, false if they cannot
+    static bool reader_type_of(nix::DataType dtype, reader_type &type)
+    {
+        switch (dtype) {
+        case nix::DataType::Bool: type = reader_type::stored; break;
+        case nix::DataType::Float: type = reader_type::float32; break;
+        case nix::DataType::Double: type = reader_type::float64; break;
+        case nix::DataType::Int8: type = reader_type::int8; break;
+        case nix::DataType::Int16: type = reader_type::int16; break;
+        case nix::DataType::Int32: type = reader_type::int32; break;
+        case nix::DataType::Int64: type = reader_type::int64; break;
+        case nix::DataType::UInt8: type = reader_type::uint8; break;
+        case nix::DataType::UInt16: type = reader_type::uint16; break;
+        case nix::DataType::UInt32: type = reader_type::uint32; break;
+        case nix::DataType::UInt64: type = reader_type::uint64; break;
+        default: return false;
+        }
+        return true;
+    }
+
+    void read_batch(const extractor &input, infusor &output)
+    {
+        nix::File fd = input.entity<nix::File>(1);
+        const size_t n = input.cell_count(2);
+
+        //without offsets and counts everything is read
+        const bool ranges = input.cell_count(3) > 0;
+        if (ranges && (input.cell_count(3) != n || input.cell_count(4) != n)) {
+            throw std::invalid_argument("offset and count must be given for every DataArray");
+        }
+
+        reader_pool *pool = nixfile::readers_of(input.hdl(1));
+        std::string file_name;
+        if (pool != nullptr) {
+            h5_id file = h5_find_file(fd.location());
+            file_name = h5_file_name(file.get());
+        }
+
+        std::vector<reader_pool::job> jobs;
+        mxArray *res = mxCreateCellMatrix(1, n);
+
+        try {
+            for (size_t i = 0; i < n; i++) {
+                handle h(input.cell_vec<uint64_t>(2, i)[0]);
+                nix::DataArray da = h.get<nix::DataArray>();
+                settle(da);
+
+                const bool colmajor = is_column_major(da);
+                nix::NDSize count = logical_extent(da, colmajor);
+                nix::NDSize offset(count.size(), 0);
+
+                if (ranges) {
+                    nix::NDSize extent = count;
+                    offset = input.cell_ndsize(3, i);
+                    count = input.cell_ndsize(4, i);
+                    check_selection(extent, count, offset);
+                }
+
+                mxArray *data = make_result(da, count);
+                mxSetCell(res, i, data);
+
+                //arrays of other files are read here
+                reader_type type;
+                if (pool == nullptr || count.nelms() == 0 || !reader_type_of(da.dataType(), type) ||
+                    h5_file_name(h5_file_of(da).get()) != file_name) {
+                    fill_data(da, colmajor, data, count, offset);
+                    continue;
+                }
+
+                h5_id dset = h5_open_data(da);
+                reader_pool::job j;
+                j.dataset = h5_path_of(dset.get());
+                j.type = type;
+                j.elsize = nix::data_type_to_size(da.dataType());
+                j.offset = colmajor ? reversed(offset) : offset;
+                j.count = colmajor ? reversed(count) : count;
+                j.out = mxGetData(data);
+                j.dst_strides = file_strides(count, colmajor);
+                jobs.push_back(j);
+            }
+
+            if (!jobs.empty()) {
+                pool->read(jobs);
+            }
+        } catch (...) {
+            mxDestroyArray(res);
+            throw;
+        }
+
+        output.set(0, res);
+    }
+
+    void read_into(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+        nix::NDSize extent = logical_extent(da, colmajor);
+
+        //the selection has the shape of the buffer; 1-d data is read
+        // into a row vector, the shape read_all returns
+        mxArray *buf = input.buffer(2);
+        nix::NDSize count;
+        if (extent.size() == 1 && mxGetNumberOfDimensions(buf) == 2 && mxGetM(buf) == 1) {
+            count = nix::NDSize(1, mxGetNumberOfElements(buf));
+        } else {
+            count = reversed(input.extent(2, extent.size()));
+        }
+        nix::NDSize offset = input.ndsize(3);
+        check_selection(extent, count, offset);
+
+        fill_prefetched(input.hdl(1), da, colmajor, buf, count, offset);
+    }
+
+    // *** scattered reads ***
+
+    static hsize_t to_index(double value, nix::ndsize_t n)
+    {
+        if (value < 0 || value != std::floor(value) || value >= static_cast<double>(n)) {
+            throw std::out_of_range("index exceeds the extent of the DataArray");
+        }
+        return static_cast<hsize_t>(value);
+    }
+
+    void read_indexed(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+        nix::NDSize extent = logical_extent(da, colmajor);
+        const size_t rank = extent.size();
+
+        if (input.cell_count(2) != rank) {
+            throw std::invalid_argument("one index vector per dimension is required");
+        }
+
+        std::vector<std::vector<hsize_t>> index(rank);
+        nix::NDSize shape(rank);
+
+        for (size_t k = 0; k < rank; k++) {
+            std::vector<double> idx = input.cell_vec<double>(2, k);
+            for (double v : idx) {
+                index[k].push_back(to_index(v, extent[k]));
+            }
+            shape[k] = idx.size();
+        }
+
+        if (colmajor) {
+            std::reverse(index.begin(), index.end());
+        }
+
+        mxArray *data = make_result(da, shape);
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        h5_read_indexed(dset.get(), memtype.get(), mxGetElementSize(data), index,
+                        mxGetData(data), file_strides(shape, colmajor));
+
+        output.set(0, data);
+    }
+
+    void read_points(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+        nix::NDSize extent = logical_extent(da, colmajor);
+        const size_t rank = extent.size();
+
+        //one point per row, one dimension per column
+        nix::NDSize size = input.extent(2, 2);
+        const size_t n = static_cast<size_t>(size[1]);
+
+        if (n > 0 && size[0] != rank) {
+            throw std::invalid_argument("points must have one coordinate per dimension");
+        }
+
+        std::vector<double> subs = input.vec<double>(2);
+        std::vector<hsize_t> coords(n * rank);
+
+        for (size_t i = 0; i < n; i++) {
+            for (size_t k = 0; k < rank; k++) {
+                const size_t f = colmajor ? rank - 1 - k : k;
+                coords[i * rank + f] = to_index(subs[i + k * n], extent[k]);
+            }
+        }
+
+        nix::NDSize shape(2, 1);
+        shape[0] = n;
+        mxArray *data = make_result(da, shape);
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        h5_read_points(dset.get(), memtype.get(), mxGetElementSize(data), coords, rank, mxGetData(data));
+
+        output.set(0, data);
+    }
+
+    void read_strided(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+        nix::NDSize extent = logical_extent(da, colmajor);
+        const size_t rank = extent.size();
+
+        nix::NDSize offset = input.ndsize(2);
+        nix::NDSize stride = input.ndsize(3);
+        nix::NDSize count = input.ndsize(4);
+        nix::NDSize block = input.ndsize(5);
+
+        if (offset.size() != rank || stride.size() != rank || count.size() != rank || block.size() != rank) {
+            throw std::invalid_argument("offset, stride, count and block must match the rank of the DataArray");
+        }
+
+        std::vector<hsize_t> h_start(rank), h_stride(rank), h_count(rank), h_block(rank);
+        nix::NDSize shape(rank);
+
+        for (size_t k = 0; k < rank; k++) {
+            if (block[k] == 0 || (count[k] > 1 && stride[k] < block[k])) {
+                throw std::invalid_argument("blocks must not be empty or overlap");
+            }
+
+            if (count[k] > 0 && offset[k] + (count[k] - 1) * stride[k] + block[k] > extent[k]) {
+                throw std::out_of_range("selection exceeds the extent of the DataArray");
+            }
+
+            const size_t f = colmajor ? rank - 1 - k : k;
+            h_start[f] = offset[k];
+            h_stride[f] = std::max(stride[k], block[k]);
+            h_count[f] = count[k];
+            h_block[f] = block[k];
+            shape[k] = count[k] * block[k];
+        }
+
+        mxArray *data = make_result(da, shape);
+
+        h5_id dset = h5_open_data(da);
+        h5_id memtype = h5_mem_type(dset.get(), da.dataType());
+        h5_read_strided(dset.get(), memtype.get(), mxGetElementSize(data), h_start, h_stride,
+                        h_count, h_block, mxGetData(data), file_strides(shape, colmajor));
+
+        output.set(0, data);
+    }
+
+    void read_calibrated(const extractor &input, infusor &output)
+    {
+        const std::string precision = input.str(2);
+        if (precision != "single" && precision != "double") {
+            throw std::invalid_argument("precision must be 'single' or 'double'");
+        }
+        const bool single = precision == "single";
+
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        //without offset and count everything is read
+        nix::NDSize extent = logical_extent(da, colmajor);
+        nix::NDSize offset = input.ndsize(3);
+        nix::NDSize count = input.ndsize(4);
+        if (offset.size() == 0 && count.size() == 0) {
+            offset = nix::NDSize(extent.size(), 0);
+            count = extent;
+        }
+        check_selection(extent, count, offset);
+
+        polynomial p;
+        p.coefficients = da.polynomCoefficients();
+        boost::optional<double> origin = da.expansionOrigin();
+        p.origin = origin ? *origin : 0;
+
+        DType2 dtype;
+        dtype.cid = single ? mxSINGLE_CLASS : mxDOUBLE_CLASS;
+        dtype.clx = mxREAL;
+        dtype.is_valid = true;
+        mxArray *data = make_mx_array_uninitialized(count, dtype);
+
+        try {
+            h5_id dset = h5_open_data(da);
+            h5_read_calibrated(dset.get(), da.dataType(), p, colmajor ? reversed(offset) : offset,
+                               colmajor ? reversed(count) : count, single, mxGetData(data),
+                               file_strides(count, colmajor), calibrate_block_bytes);
+        } catch (...) {
+            mxDestroyArray(data);
+            throw;
+        }
+
+        output.set(0, data);
+    }
+
+    //values reduced at once by reduce
+    static const size_t reduce_block_bytes = 1 << 22;
+
+    //a double array of the matlab shape for the reduced cells, which
+    // are row-major in file order
+    static mxArray *reduced_array(const nix::NDSize &shape, bool colmajor, const std::vector<double> &cells)
+    {
+        DType2 dtype;
+        dtype.cid = mxDOUBLE_CLASS;
+        dtype.clx = mxREAL;
+        dtype.is_valid = true;
+        mxArray *res = make_mx_array_uninitialized(shape, dtype);
+
+        //column-major storage is row-major in reverse
+        if (colmajor) {
+            std::copy(cells.begin(), cells.end(), mxGetPr(res));
+        } else {
+            transpose_copy(cells.data(), mxGetPr(res), sizeof(double), shape, file_strides(shape, false));
+        }
+
+        return res;
+    }
+
+    void reduce(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        nix::NDSize extent = logical_extent(da, colmajor);
+        const size_t dim = static_cast<size_t>(input.num<double>(2));
+        if (dim >= extent.size()) {
+            throw std::invalid_argument("the dimension exceeds the rank of the DataArray");
+        }
+
+        std::vector<double> edges;
+        if (input.has_field(3, "edges")) {
+            edges = input.field_vec<double>(3, "edges");
+        }
+
+        polynomial p;
+        if (input.has_field(3, "calibrated") && input.field_bool(3, "calibrated")) {
+            p.coefficients = da.polynomCoefficients();
+            boost::optional<double> origin = da.expansionOrigin();
+            p.origin = origin ? *origin : 0;
+        }
+
+        const size_t axis = colmajor ? extent.size() - 1 - dim : dim;
+        nix::NDSize fextent = colmajor ? reversed(extent) : extent;
+        axis_reducer r(fextent, axis, edges);
+
+        h5_id dset = h5_open_data(da);
+        h5_reduce(dset.get(), da.dataType(), p, r, fextent, reduce_block_bytes);
+
+        nix::NDSize shape = extent;
+        shape[dim] = 1;
+        std::vector<double> cells(r.cells());
+
+        std::vector<const char *> fields = { "mean", "std", "min", "max", "rms" };
+        if (edges.size() > 0) {
+            fields.push_back("histogram");
+        }
+        struct_builder sb({ 1 }, fields);
+
+        r.mean(cells.data());
+        sb.set(reduced_array(shape, colmajor, cells));
+        r.std_dev(cells.data());
+        sb.set(reduced_array(shape, colmajor, cells));
+        r.min(cells.data());
+        sb.set(reduced_array(shape, colmajor, cells));
+        r.max(cells.data());
+        sb.set(reduced_array(shape, colmajor, cells));
+        r.rms(cells.data());
+        sb.set(reduced_array(shape, colmajor, cells));
+
+        //the bins take the place of the reduced dimension
+        if (edges.size() > 0) {
+            shape[dim] = edges.size() - 1;
+            cells.resize(r.cells() * (edges.size() - 1));
+            r.histogram(cells.data());
+            sb.set(reduced_array(shape, colmajor, cells));
+        }
+
+        output.set(0, sb.array());
+    }
+
+    void build_zone_map(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        h5_build_zone_map(group.get(), dset.get(), da.dataType(), file_extent(da));
+        zoned[h5_key_of(da)] = true;
+    }
+
+    void drop_zone_map(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+
+        h5_id group = h5_open_group(da);
+        h5_drop_zone_map(group.get());
+        zoned[h5_key_of(da)] = false;
+    }
+
+    void find_range(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        const double lo = input.num<double>(2);
+        const double hi = input.num<double>(3);
+
+        //matlab linear indices of the positions in the file
+        nix::NDSize extent = logical_extent(da, colmajor);
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        std::vector<double> idx = h5_find_range(group.get(), dset.get(), da.dataType(),
+                                                colmajor ? reversed(extent) : extent, lo, hi,
+                                                file_strides(extent, colmajor));
+
+        nix::NDSize shape(2);
+        shape[0] = idx.size();
+        shape[1] = 1;
+
+        DType2 dtype;
+        dtype.cid = mxDOUBLE_CLASS;
+        dtype.clx = mxREAL;
+        dtype.is_valid = true;
+        mxArray *res = make_mx_array_uninitialized(shape, dtype);
+        std::copy(idx.begin(), idx.end(), mxGetPr(res));
+        output.set(0, res);
+    }
+
+    static bool is_sampled(const nix::DataArray &da, size_t axis)
+    {
+        return axis < da.dimensionCount() &&
+            da.getDimension(axis + 1).dimensionType() == nix::DimensionType::Sample;
+    }
+
+    void build_envelope(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        nix::NDSize extent = file_extent(da);
+
+        //along the given matlab dimension or the first sampled one
+        size_t axis = 0;
+        const size_t dim = static_cast<size_t>(input.num<double>(2));
+        if (dim > 0) {
+            axis = is_column_major(da) ? extent.size() - dim : dim - 1;
+        } else {
+            while (axis < extent.size() && !is_sampled(da, axis)) {
+                axis++;
+            }
+        }
+
+        if (axis >= extent.size() || !is_sampled(da, axis)) {
+            throw std::invalid_argument("an envelope requires a SampledDimension");
+        }
+
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        h5_build_envelope(group.get(), dset.get(), da.dataType(), extent, axis, envelope_block_bytes);
+        enveloped[h5_key_of(da)] = true;
+    }
+
+    void drop_envelope(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+
+        h5_id group = h5_open_group(da);
+        h5_drop_envelope(group.get());
+        enveloped[h5_key_of(da)] = false;
+    }
+
+    void read_envelope(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+
+        const double t0 = input.num<double>(2);
+        const double t1 = input.num<double>(3);
+        const size_t npix = static_cast<size_t>(input.num<double>(4));
+        if (npix == 0) {
+            throw std::invalid_argument("at least one pixel is needed");
+        }
+
+        if (!has_envelope(da)) {
+            throw std::invalid_argument("the DataArray has no envelope, see build_envelope");
+        }
+
+        h5_id group = h5_open_group(da);
+        h5_id dset = h5_open_data(da);
+        const size_t axis = h5_envelope_axis(group.get());
+        nix::NDSize extent = file_extent(da);
+
+        //the samples with times in [t0, t1]
+        nix::SampledDimension sd = da.getDimension(axis + 1).asSampledDimension();
+        const double interval = sd.samplingInterval();
+        boost::optional<double> origin = sd.offset();
+        const double start = origin ? *origin : 0;
+        const double n = static_cast<double>(extent[axis]);
+
+        const double first = std::min(std::max(std::ceil((t0 - start) / interval), 0.0), n);
+        const double last = std::min(std::max(std::floor((t1 - start) / interval) + 1, first), n);
+
+        nix::NDSize fshape = extent;
+        fshape[axis] = npix;
+        std::vector<double> lo(static_cast<size_t>(fshape.nelms())), hi(lo.size());
+        const size_t level = h5_read_envelope(group.get(), dset.get(), da.dataType(), extent,
+                                              static_cast<size_t>(first), static_cast<size_t>(last), npix,
+                                              lo.data(), hi.data());
+
+        //the time of the first sample of every pixel
+        nix::NDSize tshape(2);
+        tshape[0] = npix;
+        tshape[1] = 1;
+        std::vector<double> times(npix);
+        const double width = (last - first) / npix;
+        for (size_t p = 0; p < npix; p++) {
+            const double s = first + std::floor(p * width);
+            const double e = p + 1 == npix ? last : first + std::floor((p + 1) * width);
+            times[p] = e > s ? start + s * interval : std::numeric_limits<double>::quiet_NaN();
+        }
+
+        nix::NDSize shape = colmajor ? reversed(fshape) : fshape;
+        struct_builder sb({ 1 }, { "min", "max", "time", "level" });
+        sb.set(reduced_array(shape, colmajor, lo));
+        sb.set(reduced_array(shape, colmajor, hi));
+        sb.set(reduced_array(tshape, false, times));
+        sb.set(static_cast<double>(level));
+        output.set(0, sb.array());
+    }
+
+    // *** cursors ***
+
+    //size of the blocks of a cursor over data without chunks
+    static const size_t cursor_block_bytes = 1 << 24;
+
+    void open_cursor(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        settle(da);
+        const bool colmajor = is_column_major(da);
+        nix::NDSize extent = file_extent(da);
+        const size_t rank = extent.size();
+
+        h5_id dset = h5_open_data(da);
+        nix::NDSize chunk = h5_chunk_extent(dset.get());
+        nix::NDSize block = extent;
+
+        if (chunk.size() == rank) {
+            //blocks are multiples of the chunks, one by default
+            nix::NDSize mult(rank, 1);
+
+            if (input.has_field(2, "blocks")) {
+                mult = input.field_ndsize(2, "blocks");
+                if (mult.size() != rank) {
+                    throw std::invalid_argument("blocks must have one entry per dimension");
+                }
+                if (colmajor) {
+                    mult = reversed(mult);
+                }
+            }
+
+            for (size_t k = 0; k < rank; k++) {
+                const nix::ndsize_t n = std::max<nix::ndsize_t>(mult[k], 1);
+                block[k] = std::min(extent[k], chunk[k] * n);
+            }
+        } else if (rank > 0 && extent.nelms() > 0) {
+            //as many rows of contiguous data as fit into a block
+            const size_t row = nix::data_type_to_size(da.dataType()) *
+                static_cast<size_t>(extent.nelms() / extent[0]);
+            const nix::ndsize_t rows = std::max<size_t>(1, cursor_block_bytes / row);
+            block[0] = std::min(extent[0], rows);
+        }
+
+        output.set(0, data_cursor(da, colmajor, extent, block));
+    }
+
+    void write_range(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        nix::NDSize extent = file_extent(da);
 
         nix::DataType dtype = input.dtype(2);
-        nix::NDSize count = input.ndsize(2);
-        nix::NDSize offset(0);
-        double *ptr = input.get_raw(2);
+        nix::NDSize count = input.extent(2, extent.size());
+        nix::NDSize offset = input.ndsize(3);
+
+        if (is_column_major(da)) {
+            offset = reversed(offset);
+        }
+
+        check_selection(extent, count, offset);
+
+        store(input.hdl(1), da, dtype, input.get_raw(2), count, offset);
+        update_zones(da, dtype, input.get_raw(2), count, offset, extent, extent);
+        refresh_envelope(da, count, offset);
+    }
+
+    void append_data(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        nix::NDSize extent = file_extent(da);
+        const size_t rank = extent.size();
+
+        //the storage order is looked up once per session
+        const h5_entity_key key = h5_key_of(da);
+        auto it = appends.find(key);
+        const bool colmajor = it != appends.end() ? it->second.colmajor : is_column_major(da);
+
+        //the axis is given in the order of the matlab dimensions
+        size_t axis = static_cast<size_t>(input.num<double>(3));
+        if (axis >= rank) {
+            throw std::invalid_argument("append axis exceeds the rank of the DataArray");
+        }
+        if (colmajor) {
+            axis = rank - 1 - axis;
+        }
+
+        nix::DataType dtype = input.dtype(2);
+        nix::NDSize count = input.extent(2, rank);
+
+        for (size_t i = 0; i < rank; i++) {
+            if (i != axis && count[i] != extent[i]) {
+                throw std::invalid_argument("appended data must match the DataArray in all other dimensions");
+            }
+        }
+
+        if (count.nelms() == 0) {
+            return;
+        }
+
+        nix::NDSize offset(rank, 0);
+        offset[axis] = extent[axis];
+
+        nix::NDSize filled = extent;
+        filled[axis] += count[axis];
+
+        nix::NDSize allocated = it != appends.end() ? it->second.allocated : extent;
+
+        //SWMR readers see the extent, so it must not run ahead of the data
+        swmr_flusher *swmr = nixfile::swmr_writer_of(da);
+
+        if (filled[axis] > allocated[axis]) {
+            double growth = input.has_field(4, "growth") ?
+                input.field_num(4, "growth") : default_growth;
+
+            if (swmr != nullptr) {
+                growth = 0;
+            }
+
+            allocated[axis] = grow_to(da, axis, filled[axis], growth);
+            da.dataExtent(allocated);
+        }
+
+        extend_dimension(da, axis, count[axis], input);
+        store(input.hdl(1), da, dtype, input.get_raw(2), count, offset);
+        update_zones(da, dtype, input.get_raw(2), count, offset, extent, filled);
+
+        //appends along the envelope merge the new values, others
+        // change every bin
+        if (has_envelope(da)) {
+            h5_id group = h5_open_group(da);
+            h5_id dset = h5_open_data(da);
+
+            if (h5_envelope_axis(group.get()) == axis) {
+                h5_append_envelope(group.get(), dset.get(), da.dataType(), dtype, input.get_raw(2), count,
+                                   static_cast<size_t>(extent[axis]), filled, envelope_block_bytes);
+            } else {
+                rebuild_envelope(da, filled);
+            }
+        }
+
+        if (swmr != nullptr) {
+            swmr->appended();
+        }
+
+        if (filled == allocated) {
+            appends.erase(key);
+        } else {
+            appends[key] = append_state { da, allocated, filled, colmajor };
+        }
+    }
+
+    void finish_append(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
+        trim_append(da);
+    }
+
+    void refresh(const extractor &input, infusor &output)
+    {
+        nix::DataArray da = input.entity<nix::DataArray>(1);
 
-        da.setData(dtype, ptr, count, offset);
+        h5_refresh(da);
+        discard_prefetched(da);
     }
 
     void delete_dimension(const extractor &input, infusor &output) {
@@ -7,6 +7,11 @@ namespace nixdataarray {
 
     mxArray *describe(const nix::DataArray &da);
 
+    //throws if the group of the DataArray can not be found
+    bool is_column_major(const nix::DataArray &da);
+
+    void set_column_major(const nix::DataArray &da);
+
     void add_source(const extractor &input, infusor &output);
 
     void remove_source(const extractor &input, infusor &output);
@@ -15,6 +20,85 @@ namespace nixdataarray {
 
     void write_all(const extractor &input, infusor &output);
 
+    //stores floating point data as the integer type of the DataArray,
+    //  q = round((x - offset) / scale) saturated, and records offset
+    //  and scale as polynomial; returns the number of clipped values
+    void write_quantized(const extractor &input, infusor &output);
+
+    void read_range(const extractor &input, infusor &output);
+
+    void read_into(const extractor &input, infusor &output);
+
+    void read_indexed(const extractor &input, infusor &output);
+
+    void read_points(const extractor &input, infusor &output);
+
+    void read_strided(const extractor &input, infusor &output);
+
+    //reads the data as single or double with the polynomial and the
+    //  expansion origin applied, a block at a time
+    void read_calibrated(const extractor &input, infusor &output);
+
+    //mean, std, min, max, rms and optionally a histogram along one
+    //  dimension, computed while the data is read in blocks
+    void reduce(const extractor &input, infusor &output);
+
+    //stores the minimum and maximum of every chunk next to the data,
+    //  kept up to date by writes and appends of nix-mx
+    void build_zone_map(const extractor &input, infusor &output);
+
+    void drop_zone_map(const extractor &input, infusor &output);
+
+    //linear indices of the values in [lo, hi], skipping the chunks
+    //  whose zone bounds lie outside of the range
+    void find_range(const extractor &input, infusor &output);
+
+    //stores minima and maxima in bins of 8, 64, 512, ... samples along
+    //  a sampled dimension, kept up to date by writes and appends
+    void build_envelope(const extractor &input, infusor &output);
+
+    void drop_envelope(const extractor &input, infusor &output);
+
+    //the envelope of the samples with times in [t0, t1] in npix pixels,
+    //  from the coarsest level that still resolves them
+    void read_envelope(const extractor &input, infusor &output);
+
+    //reads blocks of several DataArrays of a file, in parallel if the
+    //  File handle has reader processes
+    void read_batch(const extractor &input, infusor &output);
+
+    void open_cursor(const extractor &input, infusor &output);
+
+    void write_range(const extractor &input, infusor &output);
+
+    void append_data(const extractor &input, infusor &output);
+
+    void finish_append(const extractor &input, infusor &output);
+
+    void set_prefetch(const extractor &input, infusor &output);
+
+    void set_async_write(const extractor &input, infusor &output);
+
+    void wait_writes(const extractor &input, infusor &output);
+
+    void flush_writes(const extractor &input, infusor &output);
+
+    //waits for the queued writes of every handle
+    void wait_all();
+
+    //reloads extent and dimensions, e.g. from a file a SWMR writer appends to
+    void refresh(const extractor &input, infusor &output);
+
+    //ends what is bound to the handle at address: read-ahead and
+    //  queued writes (whose errors are thrown)
+    void release(uint64_t address);
+
+    //trims the pending appends of the DataArrays in the file and
+    //  forgets what is cached about them
+    void release_file(const std::string &file);
+
+    void release_all();
+
     void delete_dimension(const extractor &input, infusor &output);
 
 } // namespace nixdataarray
@@ -7,9 +7,105 @@
 #include "handle.h"
 #include "arguments.h"
 #include "struct.h"
+#include "h5util.h"
+#include "flusher.h"
+#include "shmcache.h"
+#include "nixdataarray.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
 
 namespace nixfile {
 
+//our own opens of files opened with access options, per File handle;
+// they hold the tuned HDF5 file object that NIX shares
+static std::map<uint64_t, h5_id> pinned;
+
+//flush policies of the files opened for SWMR writing, per File handle
+static std::map<uint64_t, std::unique_ptr<swmr_flusher>> flushers;
+
+//reader processes, per File handle
+static std::map<uint64_t, std::unique_ptr<reader_pool>> readers;
+
+//default size of the memory shared with a reader process
+static const double default_reader_bytes = 64 << 20;
+
+//shared chunk caches of files opened ReadOnly, per File handle
+struct cache_entry {
+    std::shared_ptr<shared_chunk_cache> cache;
+    std::string file;
+    std::string key;
+};
+
+static std::map<uint64_t, cache_entry> cached;
+
+//default size of a shared chunk cache and of its slots
+static const double default_shared_cache_bytes = 256 << 20;
+static const double default_shared_slot_bytes = 1 << 20;
+
+//the shared chunk cache named in the options, if any
+static cache_entry shared_cache_options(const extractor &input, const std::string &name,
+                                        nix::FileMode mode)
+{
+    cache_entry entry;
+    if (!input.has_field(3, "sharedCache")) {
+        return entry;
+    }
+
+    //cached chunks would go stale with writes
+    if (mode != nix::FileMode::ReadOnly) {
+        throw std::invalid_argument("a shared chunk cache requires a file opened ReadOnly");
+    }
+
+    const double bytes = input.has_field(3, "sharedCacheBytes") ?
+        input.field_num(3, "sharedCacheBytes") : default_shared_cache_bytes;
+    const double slot_bytes = input.has_field(3, "sharedCacheSlotBytes") ?
+        input.field_num(3, "sharedCacheSlotBytes") : default_shared_slot_bytes;
+
+    entry.cache = shared_chunk_cache::attach(input.field_str(3, "sharedCache"),
+                                             static_cast<size_t>(bytes), static_cast<size_t>(slot_bytes));
+    entry.file = name;
+    entry.key = shared_chunk_cache::file_key(name);
+    return entry;
+}
+
+static bool has_access_options(const extractor &input)
+{
+    return input.has_field(3, "chunkCacheBytes") || input.has_field(3, "chunkCacheSlots") ||
+        input.has_field(3, "chunkCachePolicy") || input.has_field(3, "metadataCacheBytes") ||
+        input.has_field(3, "sieveBufferBytes") || input.has_field(3, "preload") ||
+        input.has_field(3, "pageSize") || input.has_field(3, "pageBufferBytes") ||
+        input.has_field(3, "metaBlockBytes") || input.has_field(3, "latestFormat") ||
+        input.has_field(3, "swmr") || input.has_field(3, "flushEvery") ||
+        input.has_field(3, "flushInterval");
+}
+
+static size_t field_bytes(const extractor &input, const char *name)
+{
+    return input.has_field(3, name) ? static_cast<size_t>(input.field_num(3, name)) : 0;
+}
+
+static h5_access access_options(const extractor &input)
+{
+    h5_access access;
+
+    access.chunk_cache_bytes = field_bytes(input, "chunkCacheBytes");
+    access.chunk_cache_slots = field_bytes(input, "chunkCacheSlots");
+    access.metadata_cache_bytes = field_bytes(input, "metadataCacheBytes");
+    access.sieve_buffer_bytes = field_bytes(input, "sieveBufferBytes");
+    access.page_buffer_bytes = field_bytes(input, "pageBufferBytes");
+    access.meta_block_bytes = field_bytes(input, "metaBlockBytes");
+    access.latest_format = input.has_field(3, "latestFormat") && input.field_bool(3, "latestFormat");
+
+    if (input.has_field(3, "chunkCachePolicy")) {
+        access.chunk_cache_policy = input.field_num(3, "chunkCachePolicy");
+    }
+
+    return access;
+}
+
 void open(const extractor &input, infusor &output)
 {
     std::string name = input.str(1);
@@ -23,19 +119,258 @@ void open(const extractor &input, infusor &output)
     default: throw std::invalid_argument("unkown open mode");
     }
 
+    cache_entry shared = shared_cache_options(input, name, mode);
+
+    if (!has_access_options(input)) {
+        nix::File fn = nix::File::open(name, mode);
+        handle h = handle(fn);
+        if (shared.cache) {
+            cached[h.address()] = shared;
+        }
+        output.set(0, h);
+        return;
+    }
+
+    h5_access access = access_options(input);
+
+    //NIX opens without the SWMR flag, but shares the file object
+    // and with it the access mode of the first open
+    const bool swmr = input.has_field(3, "swmr") && input.field_bool(3, "swmr");
+    if (swmr && mode != nix::FileMode::ReadOnly) {
+        //SWMR writing requires the latest format
+        access.latest_format = true;
+    }
+
+    //small random reads of metadata are served from memory: the file
+    // from the system cache and, once read, from a metadata cache that
+    // is as large as the file (up to the HDF5 limit) and never shrinks
+    if (input.has_field(3, "preload") && input.field_bool(3, "preload") &&
+        mode != nix::FileMode::Overwrite) {
+        const size_t size = h5_preload_file(name);
+
+        if (access.metadata_cache_bytes == 0) {
+            access.metadata_cache_bytes = std::max<size_t>(std::min(size, h5_max_metadata_cache), 1 << 20);
+        }
+        access.keep_metadata = true;
+    }
+
+    h5_id fapl = h5_make_fapl(access);
+
+    //NIX has no say in the access and creation properties: a new
+    // file is rewritten with the latter, then the file is opened
+    // with the former and NIX shares that open
+    if (mode == nix::FileMode::Overwrite) {
+        nix::File::open(name, mode).close();
+
+        h5_creation creation;
+        creation.page_size = field_bytes(input, "pageSize");
+
+        if (creation.page_size > 0 || access.latest_format) {
+            h5_recreate_file(name, creation, fapl.get());
+        }
+
+        mode = nix::FileMode::ReadWrite;
+    }
+
+    h5_id file;
+    try {
+        file = h5_pin_file(name, h5_open_flags(mode != nix::FileMode::ReadOnly, swmr), fapl.get());
+    } catch (const std::runtime_error &) {
+        if (access.page_buffer_bytes > 0) {
+            throw std::invalid_argument("page buffers require a file created with pageSize");
+        }
+        throw;
+    }
+
     nix::File fn = nix::File::open(name, mode);
     handle h = handle(fn);
 
+    if (swmr && mode != nix::FileMode::ReadOnly) {
+        const size_t every = field_bytes(input, "flushEvery");
+        const std::chrono::milliseconds interval(input.has_field(3, "flushInterval") ?
+            static_cast<long long>(input.field_num(3, "flushInterval")) : 0);
+
+        flushers[h.address()] = std::unique_ptr<swmr_flusher>(
+            new swmr_flusher(file.get(), name, every, interval));
+    }
+
+    pinned[h.address()] = std::move(file);
+    if (shared.cache) {
+        cached[h.address()] = shared;
+    }
     output.set(0, h);
 }
 
+shared_chunk_cache *shared_cache_of(const nix::DataArray &da, std::string &file_key)
+{
+    if (cached.empty()) {
+        return nullptr;
+    }
+
+    h5_id file = h5_file_of(da);
+    const std::string name = h5_file_name(file.get());
+
+    for (auto &kv : cached) {
+        if (kv.second.file == name) {
+            file_key = kv.second.key;
+            return kv.second.cache.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void remove_shared_cache(const extractor &input, infusor &output)
+{
+    shared_chunk_cache::remove(input.str(1));
+}
+
+swmr_flusher *swmr_writer_of(const nix::DataArray &da)
+{
+    if (flushers.empty()) {
+        return nullptr;
+    }
+
+    h5_id file = h5_file_of(da);
+    const std::string name = h5_file_name(file.get());
+
+    for (auto &kv : flushers) {
+        if (kv.second->file_name() == name) {
+            return kv.second.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void flush(const extractor &input, infusor &output)
+{
+    nix::File fd = input.entity<nix::File>(1);
+
+    //writes queued behind count as written
+    nixdataarray::wait_all();
+
+    auto it = flushers.find(input.hdl(1).address());
+    if (it != flushers.end()) {
+        it->second->flush();
+        return;
+    }
+
+    h5_id file = h5_find_file(fd.location());
+    h5_flush_file(file.get());
+}
+
+void start_readers(const extractor &input, infusor &output)
+{
+    nix::File fd = input.entity<nix::File>(1);
+    const uint64_t key = input.hdl(1).address();
+
+    //ends the processes of a previous call
+    readers.erase(key);
+
+    const double procs = input.num<double>(2);
+    if (procs < 1) {
+        throw std::invalid_argument("at least one reader process is needed");
+    }
+
+    //the processes take a shared lock on the file, which a writer
+    // that is not in SWMR mode holds exclusively
+    h5_id file = h5_find_file(fd.location());
+    unsigned int intent = 0;
+    H5Fget_intent(file.get(), &intent);
+
+    const bool swmr = h5_is_swmr(file.get());
+    if ((intent & H5F_ACC_RDWR) && !swmr) {
+        throw std::invalid_argument("reader processes need a file opened ReadOnly or for SWMR");
+    }
+
+    //the processes read what is on disk
+    if (intent & H5F_ACC_RDWR) {
+        nixdataarray::wait_all();
+        h5_flush_file(file.get());
+    }
+
+    const std::string program = input.has_field(3, "program") ?
+        input.field_str(3, "program") : reader_pool::default_program();
+    const double bytes = input.has_field(3, "bufferBytes") ?
+        input.field_num(3, "bufferBytes") : default_reader_bytes;
+
+    readers[key] = std::unique_ptr<reader_pool>(new reader_pool(
+        fd.location(), static_cast<size_t>(procs), program, static_cast<size_t>(bytes), swmr));
+}
+
+void stop_readers(const extractor &input, infusor &output)
+{
+    readers.erase(input.hdl(1).address());
+}
+
+reader_pool *readers_of(const handle &h)
+{
+    auto it = readers.find(h.address());
+    if (it == readers.end()) {
+        return nullptr;
+    }
+
+    //a SWMR writer makes its data visible to the processes
+    auto fl = flushers.find(h.address());
+    if (fl != flushers.end()) {
+        nixdataarray::wait_all();
+        fl->second->flush();
+    }
+
+    return it->second.get();
+}
+
+void release(uint64_t address)
+{
+    cached.erase(address);
+    readers.erase(address);
+    //the flusher uses the pinned file
+    flushers.erase(address);
+    pinned.erase(address);
+}
+
+void release_all()
+{
+    cached.clear();
+    readers.clear();
+    flushers.clear();
+    pinned.clear();
+}
+
 mxArray *describe(const nix::File &fd) {
-    struct_builder sb({ 1 }, { "format", "version", "location", "createdAt", "updatedAt" });
+    struct_builder sb({ 1 }, { "format", "version", "location", "createdAt", "updatedAt",
+        "chunkCacheBytes", "chunkCacheSlots", "chunkCachePolicy", "metadataCacheBytes",
+        "sieveBufferBytes", "pageSize", "pageBufferBytes", "metaBlockBytes", "latestFormat", "swmr" });
     sb.set(fd.format());
     sb.set(fd.version());
     sb.set(fd.location());
     sb.set(static_cast<uint64_t>(fd.createdAt()));
     sb.set(static_cast<uint64_t>(fd.updatedAt()));
+
+    h5_access access;
+    h5_creation creation;
+    bool swmr = false;
+    try {
+        h5_id file = h5_find_file(fd.location());
+        access = h5_get_access(file.get());
+        creation = h5_get_creation(file.get());
+        swmr = h5_is_swmr(file.get());
+    } catch (const std::runtime_error &) {
+        //not visible to us, report zeros
+        access.chunk_cache_policy = 0;
+    }
+
+    sb.set(static_cast<double>(access.chunk_cache_bytes));
+    sb.set(static_cast<double>(access.chunk_cache_slots));
+    sb.set(access.chunk_cache_policy);
+    sb.set(static_cast<double>(access.metadata_cache_bytes));
+    sb.set(static_cast<double>(access.sieve_buffer_bytes));
+    sb.set(static_cast<double>(creation.page_size));
+    sb.set(static_cast<double>(access.page_buffer_bytes));
+    sb.set(static_cast<double>(access.meta_block_bytes));
+    sb.set(access.latest_format);
+    sb.set(swmr);
     return sb.array();
 }
 
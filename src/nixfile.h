@@ -2,11 +2,42 @@
 #define NIX_MX_FILE
 
 #include "arguments.h"
+#include "flusher.h"
+#include "readerpool.h"
+#include "shmcache.h"
 
 namespace nixfile {
 
 void open(const extractor &input, infusor &output);
 
+//flushes the file, so that SWMR readers see what has been written
+void flush(const extractor &input, infusor &output);
+
+//the flush policy of the file of the DataArray if the file is
+//  written in SWMR mode, else null
+swmr_flusher *swmr_writer_of(const nix::DataArray &da);
+
+//the shared chunk cache the file of the DataArray was opened with,
+//  or null; file_key identifies the file in the cache
+shared_chunk_cache *shared_cache_of(const nix::DataArray &da, std::string &file_key);
+
+//removes a shared chunk cache by name, see shmcache.h
+void remove_shared_cache(const extractor &input, infusor &output);
+
+//starts reader processes for the file, see readerpool.h
+void start_readers(const extractor &input, infusor &output);
+
+void stop_readers(const extractor &input, infusor &output);
+
+//the reader processes of the File handle, or null; what has been
+//  written to the file is flushed for them
+reader_pool *readers_of(const handle &h);
+
+//closes what has been opened along with the File handle at address
+void release(uint64_t address);
+
+void release_all();
+
 mxArray *describe(const nix::File &f);
 
 } // namespace nixfile
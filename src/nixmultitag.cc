@@ -53,6 +53,16 @@ namespace nixmultitag {
         output.set(0, data);
     }
 
+    void retrieve_data_into(const extractor &input, infusor &output) {
+        nix::MultiTag currObj = input.entity<nix::MultiTag>(1);
+        double p_index = input.num<double>(2);
+        double f_index = input.num<double>(3);
+
+        nix::DataView view = currObj.retrieveData(p_index, f_index);
+        nix::NDSize count = view.dataExtent();
+        fill_mx_array_from_ds(view, input.buffer(4), count, nix::NDSize(count.size(), 0));
+    }
+
     void retrieve_feature_data(const extractor &input, infusor &output) {
         nix::MultiTag currObj = input.entity<nix::MultiTag>(1);
         double p_index = input.num<double>(2);
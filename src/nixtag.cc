@@ -54,6 +54,15 @@ namespace nixtag {
         output.set(0, data);
     }
 
+    void retrieve_data_into(const extractor &input, infusor &output) {
+        nix::Tag currObj = input.entity<nix::Tag>(1);
+        double index = input.num<double>(2);
+
+        nix::DataView view = currObj.retrieveData(index);
+        nix::NDSize count = view.dataExtent();
+        fill_mx_array_from_ds(view, input.buffer(3), count, nix::NDSize(count.size(), 0));
+    }
+
     void retrieve_feature_data(const extractor &input, infusor &output) {
         nix::Tag currObj = input.entity<nix::Tag>(1);
         double index = input.num<double>(2);
@@ -15,6 +15,8 @@ namespace nixtag {
 
     void retrieve_data(const extractor &input, infusor &output);
 
+    void retrieve_data_into(const extractor &input, infusor &output);
+
     void retrieve_feature_data(const extractor &input, infusor &output);
 
 } // namespace nixtag
@@ -76,7 +76,27 @@ public:
     nix::NDSize ndsize(size_t pos) const {
         return mx_to_ndsize(array[pos]);
     }
+
+    nix::NDSize extent(size_t pos, size_t rank) const {
+        return mx_to_extent(array[pos], rank);
+    }
     
+    size_t cell_count(size_t pos) const {
+        if (!mxIsCell(array[pos])) {
+            throw std::invalid_argument("argument must be a cell array");
+        }
+        return mxGetNumberOfElements(array[pos]);
+    }
+
+    template<typename T>
+    std::vector<T> cell_vec(size_t pos, size_t idx) const {
+        return mx_to_vector<T>(mxGetCell(array[pos], idx));
+    }
+
+    nix::NDSize cell_ndsize(size_t pos, size_t idx) const {
+        return mx_to_ndsize(mxGetCell(array[pos], idx));
+    }
+
     nix::DataType dtype(size_t pos) const {
         return dtype_mex2nix(array[pos]);
     }
@@ -114,7 +134,48 @@ public:
         return mxGetPr(array[pos]);
     }
 
+    //the argument itself, for commands that fill a buffer in place;
+    // matlab shares data between copies, so the caller must make sure
+    // the buffer is not shared with other variables
+    mxArray* buffer(size_t pos) const {
+        return const_cast<mxArray *>(array[pos]);
+    }
+
+    // optional arguments, passed as fields of a struct
+
+    bool has_field(size_t pos, const char *name) const {
+        const mxArray *f = field(pos, name);
+        return f != nullptr && !mxIsEmpty(f);
+    }
+
+    std::string field_str(size_t pos, const char *name) const {
+        return mx_to_str(field(pos, name));
+    }
+
+    double field_num(size_t pos, const char *name) const {
+        return mxGetScalar(field(pos, name));
+    }
+
+    bool field_bool(size_t pos, const char *name) const {
+        return mxGetScalar(field(pos, name)) != 0;
+    }
+
+    nix::NDSize field_ndsize(size_t pos, const char *name) const {
+        return mx_to_ndsize(field(pos, name));
+    }
+
+    template<typename T>
+    std::vector<T> field_vec(size_t pos, const char *name) const {
+        return mx_to_vector<T>(field(pos, name));
+    }
+
 private:
+    const mxArray *field(size_t pos, const char *name) const {
+        if (pos >= number || !mxIsStruct(array[pos])) {
+            return nullptr;
+        }
+        return mxGetField(array[pos], 0, name);
+    }
 };
 
 template<>
@@ -0,0 +1,260 @@
+#include "calibrate.h"
+#include "h5util.h"
+#include "h5select.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+//values calibrated at once, small enough for the stack and the L1 cache
+static const size_t batch = 512;
+
+template<typename In, typename Out>
+static void calibrate(const polynomial &p, const In *in, size_t n, Out *out)
+{
+    const double *c = p.coefficients.data();
+    const size_t nc = p.coefficients.size();
+    double x[batch], acc[batch];
+
+    for (size_t start = 0; start < n; start += batch) {
+        const size_t m = std::min(batch, n - start);
+
+        for (size_t i = 0; i < m; i++) {
+            x[i] = static_cast<double>(in[start + i]) - p.origin;
+        }
+
+        if (nc == 0) {
+            for (size_t i = 0; i < m; i++) {
+                out[start + i] = static_cast<Out>(x[i]);
+            }
+            continue;
+        }
+
+        //Horner, from the highest coefficient down
+        for (size_t i = 0; i < m; i++) {
+            acc[i] = c[nc - 1];
+        }
+
+        for (size_t k = nc - 1; k-- > 0;) {
+            const double ck = c[k];
+            for (size_t i = 0; i < m; i++) {
+                acc[i] = acc[i] * x[i] + ck;
+            }
+        }
+
+        for (size_t i = 0; i < m; i++) {
+            out[start + i] = static_cast<Out>(acc[i]);
+        }
+    }
+}
+
+template<typename In>
+static void calibrate_to(const polynomial &p, const void *in, size_t n, bool single, void *out)
+{
+    const In *src = static_cast<const In *>(in);
+
+    if (single) {
+        calibrate(p, src, n, static_cast<float *>(out));
+    } else {
+        calibrate(p, src, n, static_cast<double *>(out));
+    }
+}
+
+void apply_polynomial(const polynomial &p, nix::DataType dtype, const void *in, size_t n,
+                      bool single, void *out)
+{
+    switch (dtype) {
+    case nix::DataType::Float: calibrate_to<float>(p, in, n, single, out); break;
+    case nix::DataType::Double: calibrate_to<double>(p, in, n, single, out); break;
+    case nix::DataType::Int8: calibrate_to<int8_t>(p, in, n, single, out); break;
+    case nix::DataType::Int16: calibrate_to<int16_t>(p, in, n, single, out); break;
+    case nix::DataType::Int32: calibrate_to<int32_t>(p, in, n, single, out); break;
+    case nix::DataType::Int64: calibrate_to<int64_t>(p, in, n, single, out); break;
+    case nix::DataType::UInt8: calibrate_to<uint8_t>(p, in, n, single, out); break;
+    case nix::DataType::UInt16: calibrate_to<uint16_t>(p, in, n, single, out); break;
+    case nix::DataType::UInt32: calibrate_to<uint32_t>(p, in, n, single, out); break;
+    case nix::DataType::UInt64: calibrate_to<uint64_t>(p, in, n, single, out); break;
+    default: throw std::domain_error("only numeric data can be calibrated");
+    }
+}
+
+void h5_read_calibrated(hid_t dset, nix::DataType dtype, const polynomial &p,
+                        const nix::NDSize &offset, const nix::NDSize &count, bool single,
+                        void *out, const std::vector<size_t> &dst_strides, size_t block_bytes)
+{
+    if (count.nelms() == 0) {
+        return;
+    }
+
+    h5_id memtype = h5_mem_type(dset, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+    const size_t outsize = single ? sizeof(float) : sizeof(double);
+
+    //slabs along the first axis; a row spans the following ones
+    const size_t row = static_cast<size_t>(count.nelms() / count[0]);
+    const size_t rows = std::max<size_t>(1, block_bytes / (row * elsize));
+
+    //rows of out that are laid out like the slab take the values directly
+    const bool rowmajor = is_rowmajor(count, dst_strides);
+
+    std::vector<hsize_t> h_offset(offset.begin(), offset.end());
+    std::vector<hsize_t> h_count(count.begin(), count.end());
+    std::vector<char> raw, values;
+    nix::NDSize slab = count;
+
+    for (size_t first = 0; first < count[0]; first += rows) {
+        slab[0] = std::min<nix::ndsize_t>(rows, count[0] - first);
+        h_offset[0] = offset[0] + first;
+        h_count[0] = slab[0];
+
+        const size_t n = static_cast<size_t>(slab.nelms());
+        raw.resize(n * elsize);
+        h5_read_hyperslab(dset, memtype.get(), h_offset, h_count, raw.data());
+
+        char *dst = static_cast<char *>(out) + first * dst_strides[0] * outsize;
+        if (rowmajor) {
+            apply_polynomial(p, dtype, raw.data(), n, single, dst);
+        } else {
+            values.resize(n * outsize);
+            apply_polynomial(p, dtype, raw.data(), n, single, values.data());
+            transpose_copy(values.data(), dst, outsize, slab, dst_strides);
+        }
+    }
+}
+
+//the largest double that converts to T; the maxima of 64 bit types
+// round up to the next power of two as doubles
+template<typename T>
+static double upper_limit()
+{
+    const double hi = static_cast<double>(std::numeric_limits<T>::max());
+    return static_cast<T>(hi) == std::numeric_limits<T>::max() ? hi : std::nextafter(hi, 0.0);
+}
+
+template<typename In, typename Out>
+static size_t quantize_to(const In *in, size_t n, double scale, double offset, Out *out)
+{
+    const double inv = 1 / scale;
+    const double lo = static_cast<double>(std::numeric_limits<Out>::min());
+    const double hi = upper_limit<Out>();
+    size_t clipped = 0;
+
+    //rounding half away from zero is adding one half towards the
+    // sign and truncating, which the conversion does; plain selects
+    // instead of std::round keep the loop vectorizable
+    for (size_t i = 0; i < n; i++) {
+        double v = (static_cast<double>(in[i]) - offset) * inv;
+        v += v < 0 ? -0.5 : 0.5;
+        clipped += !(v > lo - 1 && v < hi + 1);
+
+        //NaN compares false
+        v = v == v ? v : 0;
+        v = v < lo ? lo : v;
+        v = v > hi ? hi : v;
+        out[i] = static_cast<Out>(v);
+    }
+
+    return clipped;
+}
+
+template<typename In>
+static size_t quantize_from(const In *in, size_t n, double scale, double offset, nix::DataType dtype,
+                            void *out)
+{
+    switch (dtype) {
+    case nix::DataType::Int8: return quantize_to(in, n, scale, offset, static_cast<int8_t *>(out));
+    case nix::DataType::Int16: return quantize_to(in, n, scale, offset, static_cast<int16_t *>(out));
+    case nix::DataType::Int32: return quantize_to(in, n, scale, offset, static_cast<int32_t *>(out));
+    case nix::DataType::Int64: return quantize_to(in, n, scale, offset, static_cast<int64_t *>(out));
+    case nix::DataType::UInt8: return quantize_to(in, n, scale, offset, static_cast<uint8_t *>(out));
+    case nix::DataType::UInt16: return quantize_to(in, n, scale, offset, static_cast<uint16_t *>(out));
+    case nix::DataType::UInt32: return quantize_to(in, n, scale, offset, static_cast<uint32_t *>(out));
+    case nix::DataType::UInt64: return quantize_to(in, n, scale, offset, static_cast<uint64_t *>(out));
+    default: throw std::domain_error("quantized data must be stored as integers");
+    }
+}
+
+void check_quantization(nix::DataType in_type, double scale, double offset, nix::DataType dtype)
+{
+    if (scale == 0 || !std::isfinite(scale) || !std::isfinite(offset)) {
+        throw std::invalid_argument("scale must be finite and non-zero, offset finite");
+    }
+
+    if (in_type != nix::DataType::Float && in_type != nix::DataType::Double) {
+        throw std::invalid_argument("only single and double data can be quantized");
+    }
+
+    switch (dtype) {
+    case nix::DataType::Int8:
+    case nix::DataType::Int16:
+    case nix::DataType::Int32:
+    case nix::DataType::Int64:
+    case nix::DataType::UInt8:
+    case nix::DataType::UInt16:
+    case nix::DataType::UInt32:
+    case nix::DataType::UInt64:
+        break;
+    default:
+        throw std::domain_error("quantized data must be stored as integers");
+    }
+}
+
+size_t quantize(nix::DataType in_type, const void *in, size_t n, double scale, double offset,
+                nix::DataType dtype, void *out)
+{
+    check_quantization(in_type, scale, offset, dtype);
+
+    switch (in_type) {
+    case nix::DataType::Float:
+        return quantize_from(static_cast<const float *>(in), n, scale, offset, dtype, out);
+    case nix::DataType::Double:
+        return quantize_from(static_cast<const double *>(in), n, scale, offset, dtype, out);
+    default:
+        throw std::invalid_argument("only single and double data can be quantized");
+    }
+}
+
+size_t h5_write_quantized(hid_t dset, nix::DataType dtype, nix::DataType in_type, const void *data,
+                          const nix::NDSize &count, double scale, double offset, size_t block_bytes)
+{
+    const size_t rank = count.size();
+    if (count.nelms() == 0) {
+        return 0;
+    }
+
+    h5_id memtype = h5_mem_type(dset, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+    const size_t insize = nix::data_type_to_size(in_type);
+
+    //slabs along the first axis, made of whole chunks if possible so
+    // that HDF5 does not read back the chunks it has written in part
+    const size_t row = static_cast<size_t>(count.nelms() / count[0]);
+    size_t rows = std::max<size_t>(1, block_bytes / (row * elsize));
+
+    nix::NDSize chunks = h5_chunk_extent(dset);
+    if (chunks.size() == rank) {
+        const size_t quantum = static_cast<size_t>(chunks[0]);
+        rows = std::max(quantum, rows / quantum * quantum);
+    }
+
+    std::vector<hsize_t> h_offset(rank, 0);
+    std::vector<hsize_t> h_count(count.begin(), count.end());
+    std::vector<char> stored;
+    size_t clipped = 0;
+
+    for (size_t first = 0; first < count[0]; first += rows) {
+        h_offset[0] = first;
+        h_count[0] = std::min<hsize_t>(rows, count[0] - first);
+
+        const size_t n = static_cast<size_t>(h_count[0]) * row;
+        stored.resize(n * elsize);
+        clipped += quantize(in_type, static_cast<const char *>(data) + first * row * insize, n,
+                            scale, offset, dtype, stored.data());
+        h5_write_hyperslab(dset, memtype.get(), h_offset, h_count, stored.data());
+    }
+
+    return clipped;
+}
@@ -0,0 +1,62 @@
+#ifndef NIX_MX_CALIBRATE_H
+#define NIX_MX_CALIBRATE_H
+
+#include <hdf5.h>
+#include <nix/DataType.hpp>
+#include <nix/NDSize.hpp>
+
+#include <vector>
+
+/*
+  Calibrated reads: the stored values are read a block at a time,
+  calibrated like nix::util::applyPolynomial does,
+
+    out = sum_k coefficients[k] * (in - origin)^k
+
+  (out = in - origin without coefficients) and written as float or
+  double straight to the output, so that no temporaries the size of
+  the data are needed. The polynomial is evaluated with Horner's
+  scheme one term at a time over a block, which compilers vectorize.
+
+  Quantized writes are the inverse for a linear polynomial: floating
+  point values are stored as integers q = round((x - offset) / scale),
+  i.e. x = offset + scale * q, again a block at a time.
+*/
+
+struct polynomial {
+    std::vector<double> coefficients;
+    double origin;
+
+    polynomial() : origin(0) { }
+};
+
+//calibrates n values of the numeric type dtype as float (single)
+//  or double to out
+void apply_polynomial(const polynomial &p, nix::DataType dtype, const void *in, size_t n,
+                      bool single, void *out);
+
+//reads the block at offset (file order) of the dataset calibrated to
+//  out, whose axes are laid out according to dst_strides (in elements);
+//  at most block_bytes of stored values are read at a time
+void h5_read_calibrated(hid_t dset, nix::DataType dtype, const polynomial &p,
+                        const nix::NDSize &offset, const nix::NDSize &count, bool single,
+                        void *out, const std::vector<size_t> &dst_strides, size_t block_bytes);
+
+//throws unless values of in_type can be quantized with scale and
+//  offset to dtype
+void check_quantization(nix::DataType in_type, double scale, double offset, nix::DataType dtype);
+
+//quantizes n values of in_type (float or double) to the integer type
+//  dtype, rounding half away from zero; values out of its range
+//  saturate and NaN becomes 0. Returns the number of those values.
+size_t quantize(nix::DataType in_type, const void *in, size_t n, double scale, double offset,
+                nix::DataType dtype, void *out);
+
+//writes the row-major block `data` of in_type quantized to [0, count)
+//  of the dataset of integer type dtype; at most block_bytes of stored
+//  values are written at a time, in whole chunks along the first axis.
+//  Returns the number of values that were clipped.
+size_t h5_write_quantized(hid_t dset, nix::DataType dtype, nix::DataType in_type, const void *data,
+                          const nix::NDSize &count, double scale, double offset, size_t block_bytes);
+
+#endif
@@ -0,0 +1,365 @@
+#include "chunkread.h"
+#include "h5util.h"
+#include "h5select.h"
+#include "transpose.h"
+#include "shmcache.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+void unshuffle(const std::vector<char> &src, std::vector<char> &dst, size_t elsize)
+{
+    const size_t n = src.size() / elsize;
+    dst.resize(src.size());
+
+    for (size_t b = 0; b < elsize; b++) {
+        const char *from = src.data() + b * n;
+        for (size_t i = 0; i < n; i++) {
+            dst[i * elsize + b] = from[i];
+        }
+    }
+
+    //bytes that do not make up a full element are not shuffled
+    const size_t rest = n * elsize;
+    std::copy(src.begin() + rest, src.end(), dst.begin() + rest);
+}
+
+} // namespace
+
+bool h5_read_raw_chunk(hid_t dset, const std::vector<hsize_t> &offset, std::vector<char> &data,
+                       unsigned int &mask)
+{
+#if H5_VERSION_GE(1, 10, 2)
+    //chunks that were never written have no storage (and depending
+    // on the index no address either)
+    hsize_t nbytes = 0;
+    herr_t err;
+    H5E_BEGIN_TRY {
+        err = H5Dget_chunk_storage_size(dset, offset.data(), &nbytes);
+    } H5E_END_TRY;
+
+    if (err < 0 || nbytes == 0) {
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(nbytes));
+    uint32_t filter_mask = 0;
+    if (H5Dread_chunk(dset, H5P_DEFAULT, offset.data(), &filter_mask, data.data()) < 0) {
+        throw std::runtime_error("could not read chunk");
+    }
+
+    mask = filter_mask;
+    return true;
+#else
+    throw std::runtime_error("direct chunk reads require HDF5 1.10.2");
+#endif
+}
+
+void h5_decode_chunk(const std::vector<h5_filter> &filters, unsigned int mask, size_t elsize,
+                     size_t nbytes, std::vector<char> &a, std::vector<char> &b)
+{
+    //undo the filters in reverse order
+    for (size_t i = filters.size(); i-- > 0;) {
+        if (mask & (1u << i)) {
+            continue;
+        }
+
+        if (filters[i].id == H5Z_FILTER_DEFLATE) {
+            b.resize(nbytes);
+            uLongf len = static_cast<uLongf>(nbytes);
+            if (uncompress(reinterpret_cast<Bytef *>(b.data()), &len,
+                           reinterpret_cast<const Bytef *>(a.data()),
+                           static_cast<uLong>(a.size())) != Z_OK) {
+                throw std::runtime_error("could not inflate chunk");
+            }
+            b.resize(len);
+        } else {
+            unshuffle(a, b, elsize);
+        }
+
+        a.swap(b);
+    }
+
+    if (a.size() != nbytes) {
+        throw std::runtime_error("chunk has the wrong size after decoding");
+    }
+}
+
+namespace {
+
+struct raw_chunk {
+    nix::NDSize offset;
+    std::vector<char> data;
+    unsigned int mask; //filters skipped for this chunk
+    bool raw;          //false: read by HDF5 already and cut to size
+};
+
+class chunk_decoder {
+public:
+    chunk_decoder(const std::vector<h5_filter> &filters, size_t elsize, const nix::NDSize &chunk, const nix::NDSize &extent,
+                  char *out, const std::vector<size_t> &dst_strides, size_t threads)
+        : filters(filters), elsize(elsize), chunk(chunk), extent(extent), out(out),
+          dst_strides(dst_strides), max_queued(4 * threads), done(false)
+    {
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(&chunk_decoder::run, this);
+        }
+    }
+
+    ~chunk_decoder() {
+        finish();
+    }
+
+    void push(raw_chunk &&rc) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_space.wait(lock, [this] { return queue.size() < max_queued || !error.empty(); });
+        queue.push_back(std::move(rc));
+        cv_items.notify_one();
+    }
+
+    //waits for the workers to decode what has been pushed
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            done = true;
+        }
+        cv_items.notify_all();
+
+        for (std::thread &t : workers) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+    std::string failure() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return error;
+    }
+
+private:
+    void run() {
+        std::vector<char> a, b, block;
+
+        while (true) {
+            raw_chunk rc;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_items.wait(lock, [this] { return done || !queue.empty(); });
+
+                if (queue.empty()) {
+                    return;
+                }
+
+                rc = std::move(queue.front());
+                queue.pop_front();
+                cv_space.notify_one();
+            }
+
+            try {
+                a.swap(rc.data);
+                if (rc.raw) {
+                    h5_decode_chunk(filters, rc.mask, elsize, static_cast<size_t>(chunk.nelms()) * elsize, a, b);
+                }
+                scatter(rc.offset, a, block, rc.raw);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (error.empty()) {
+                    error = e.what();
+                }
+                cv_space.notify_all();
+            }
+        }
+    }
+
+    //copies the part of the chunk inside the extent to the output
+    void scatter(const nix::NDSize &offset, const std::vector<char> &data, std::vector<char> &block, bool full) {
+        const size_t rank = chunk.size();
+        nix::NDSize count(rank);
+        size_t dst = 0;
+
+        for (size_t k = 0; k < rank; k++) {
+            count[k] = std::min(chunk[k], extent[k] - offset[k]);
+            dst += static_cast<size_t>(offset[k]) * dst_strides[k];
+        }
+
+        const char *src = data.data();
+
+        //edge chunks are stored in full, cut them to size first
+        if (full && count != chunk) {
+            block.resize(static_cast<size_t>(count.nelms()) * elsize);
+            extract_block(data.data(), chunk, nix::NDSize(rank, 0), count, elsize, block.data());
+            src = block.data();
+        }
+
+        transpose_copy(src, out + dst * elsize, elsize, count, dst_strides);
+    }
+
+    const std::vector<h5_filter> &filters;
+    size_t elsize;
+    nix::NDSize chunk;
+    nix::NDSize extent;
+    char *out;
+    std::vector<size_t> dst_strides;
+    size_t max_queued;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv_items;
+    std::condition_variable cv_space;
+    std::deque<raw_chunk> queue;
+    bool done;
+    std::string error;
+
+    std::vector<std::thread> workers;
+};
+
+} // namespace
+
+void h5_read_chunks_parallel(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &extent,
+                             void *out, const std::vector<size_t> &dst_strides, size_t threads)
+{
+#if H5_VERSION_GE(1, 10, 2)
+    const nix::NDSize chunk = h5_chunk_extent(dset);
+    const size_t rank = chunk.size();
+
+    std::vector<h5_filter> filters;
+    h5_simple_filters(dset, filters);
+
+    if (extent.nelms() == 0) {
+        return;
+    }
+
+    chunk_decoder decoder(filters, elsize, chunk, extent, static_cast<char *>(out),
+                          dst_strides, std::max<size_t>(threads, 1));
+
+    //walk the chunk grid in storage order, fetching is left to this thread
+    std::vector<hsize_t> offset(rank, 0);
+    bool more = true;
+
+    while (more && decoder.failure().empty()) {
+        raw_chunk rc;
+        rc.offset = nix::NDSize(rank);
+        std::copy(offset.begin(), offset.end(), rc.offset.begin());
+        rc.mask = 0;
+
+        //HDF5 knows the fill value of chunks without storage
+        rc.raw = h5_read_raw_chunk(dset, offset, rc.data, rc.mask);
+        if (!rc.raw) {
+            std::vector<hsize_t> count(rank);
+            size_t nelms = 1;
+            for (size_t k = 0; k < rank; k++) {
+                count[k] = std::min<hsize_t>(chunk[k], extent[k] - offset[k]);
+                nelms *= static_cast<size_t>(count[k]);
+            }
+            rc.data.resize(nelms * elsize);
+            h5_read_hyperslab(dset, memtype, offset, count, rc.data.data());
+        }
+
+        decoder.push(std::move(rc));
+
+        more = false;
+        for (size_t k = rank; k-- > 0;) {
+            offset[k] += chunk[k];
+            if (offset[k] < extent[k]) {
+                more = true;
+                break;
+            }
+            offset[k] = 0;
+        }
+    }
+
+    decoder.finish();
+
+    if (!decoder.failure().empty()) {
+        throw std::runtime_error(decoder.failure());
+    }
+#else
+    throw std::runtime_error("direct chunk reads require HDF5 1.10.2");
+#endif
+}
+
+void h5_read_chunks_cached(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &offset,
+                           const nix::NDSize &count, void *out, const std::vector<size_t> &dst_strides,
+                           shared_chunk_cache &cache, const std::string &key)
+{
+    const nix::NDSize chunk = h5_chunk_extent(dset);
+    const size_t rank = chunk.size();
+    const size_t nbytes = static_cast<size_t>(chunk.nelms()) * elsize;
+
+    std::vector<h5_filter> filters;
+    h5_simple_filters(dset, filters);
+
+    if (count.nelms() == 0) {
+        return;
+    }
+
+    //the chunks overlapping the selection, in storage order
+    std::vector<uint64_t> first(rank);
+    for (size_t k = 0; k < rank; k++) {
+        first[k] = offset[k] / chunk[k] * chunk[k];
+    }
+
+    std::vector<uint64_t> pos = first;
+    std::vector<char> a, b, block;
+    nix::NDSize in_offset(rank), in_count(rank);
+
+    while (true) {
+        //the part of the chunk that is selected
+        size_t dst = 0;
+        for (size_t k = 0; k < rank; k++) {
+            const nix::ndsize_t lo = std::max<nix::ndsize_t>(pos[k], offset[k]);
+            const nix::ndsize_t hi = std::min<nix::ndsize_t>(pos[k] + chunk[k], offset[k] + count[k]);
+            in_offset[k] = lo - pos[k];
+            in_count[k] = hi - lo;
+            dst += static_cast<size_t>(lo - offset[k]) * dst_strides[k];
+        }
+
+        const shm_key ck = shared_chunk_cache::make_key(key, pos);
+        const std::vector<hsize_t> h_pos(pos.begin(), pos.end());
+        unsigned int mask = 0;
+
+        a.resize(nbytes);
+        bool plain = cache.get(ck, a.data(), nbytes);
+        if (!plain && h5_read_raw_chunk(dset, h_pos, a, mask)) {
+            h5_decode_chunk(filters, mask, elsize, nbytes, a, b);
+            cache.put(ck, a.data(), nbytes);
+            plain = true;
+        }
+
+        block.resize(static_cast<size_t>(in_count.nelms()) * elsize);
+        if (plain) {
+            extract_block(a.data(), chunk, in_offset, in_count, elsize, block.data());
+        } else {
+            //no storage, HDF5 knows the fill value
+            std::vector<hsize_t> h_offset(rank), h_count(in_count.begin(), in_count.end());
+            for (size_t k = 0; k < rank; k++) {
+                h_offset[k] = pos[k] + in_offset[k];
+            }
+            h5_read_hyperslab(dset, memtype, h_offset, h_count, block.data());
+        }
+
+        transpose_copy(block.data(), static_cast<char *>(out) + dst * elsize, elsize, in_count, dst_strides);
+
+        size_t k = rank;
+        while (k-- > 0) {
+            pos[k] += chunk[k];
+            if (pos[k] < offset[k] + count[k]) {
+                break;
+            }
+            pos[k] = first[k];
+        }
+        if (k == static_cast<size_t>(-1)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef NIX_MX_CHUNKREAD_H
+#define NIX_MX_CHUNKREAD_H
+
+#include "h5util.h"
+
+#include <hdf5.h>
+#include <nix/NDSize.hpp>
+
+#include <string>
+#include <vector>
+
+/*
+  Reads compressed data without HDF5's filter pipeline: the chunks
+  are fetched as stored (direct chunk read, HDF5 1.10.2) and inflated
+  by a pool of threads that never touch HDF5, then copied into place.
+
+  Supported are the datasets h5_direct_chunks accepts; everything
+  else is left to HDF5.
+*/
+
+class shared_chunk_cache;
+
+//reads the chunk at offset as stored, false if it has no storage
+bool h5_read_raw_chunk(hid_t dset, const std::vector<hsize_t> &offset, std::vector<char> &data,
+                       unsigned int &mask);
+
+//undoes the filters of a stored chunk in `a` that are not skipped by
+//  mask (see H5Dread_chunk), leaving the nbytes of plain data in `a`
+void h5_decode_chunk(const std::vector<h5_filter> &filters, unsigned int mask, size_t elsize,
+                     size_t nbytes, std::vector<char> &a, std::vector<char> &b);
+
+//reads the block [0, extent) of the dataset (file order) into out,
+//  whose axes are laid out according to dst_strides (in elements)
+void h5_read_chunks_parallel(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &extent,
+                             void *out, const std::vector<size_t> &dst_strides, size_t threads);
+
+//reads the block at offset (file order) into out like the above, but
+//  chunk by chunk on the calling thread, taking plain chunks from the
+//  shared cache and adding those read; key identifies the dataset (see
+//  shared_chunk_cache::make_key). Unfiltered datasets are supported.
+void h5_read_chunks_cached(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &offset,
+                           const nix::NDSize &count, void *out, const std::vector<size_t> &dst_strides,
+                           shared_chunk_cache &cache, const std::string &key);
+
+#endif
@@ -0,0 +1,250 @@
+#include "chunkwrite.h"
+#include "h5util.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void shuffle(const std::vector<char> &src, std::vector<char> &dst, size_t elsize)
+{
+    const size_t n = src.size() / elsize;
+    dst.resize(src.size());
+
+    for (size_t b = 0; b < elsize; b++) {
+        char *to = dst.data() + b * n;
+        for (size_t i = 0; i < n; i++) {
+            to[i] = src[i * elsize + b];
+        }
+    }
+
+    //bytes that do not make up a full element are not shuffled
+    const size_t rest = n * elsize;
+    std::copy(src.begin() + rest, src.end(), dst.begin() + rest);
+}
+
+class chunk_encoder {
+public:
+    chunk_encoder(const std::vector<h5_filter> &filters, size_t elsize, const nix::NDSize &chunk,
+                  const nix::NDSize &extent, const std::vector<char> &fill, const char *data,
+                  size_t nchunks, size_t threads)
+        : filters(filters), elsize(elsize), chunk(chunk), extent(extent), fill(fill), data(data),
+          nchunks(nchunks), window(4 * threads), next(0), written(0), stopping(false)
+    {
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(&chunk_encoder::run, this);
+        }
+    }
+
+    ~chunk_encoder() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv_work.notify_all();
+
+        for (std::thread &t : workers) {
+            t.join();
+        }
+    }
+
+    //the encoded chunk with the given index, in the order of the grid
+    std::vector<char> take(size_t index) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_done.wait(lock, [&] { return !error.empty() || done.count(index) > 0; });
+
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+
+        std::vector<char> res = std::move(done[index]);
+        done.erase(index);
+        written = index + 1;
+        cv_work.notify_all();
+        return res;
+    }
+
+    //position of a chunk in the grid, in elements
+    nix::NDSize offset_of(size_t index) const {
+        const size_t rank = chunk.size();
+        nix::NDSize offset(rank);
+
+        for (size_t k = rank; k-- > 0;) {
+            const size_t n = static_cast<size_t>((extent[k] + chunk[k] - 1) / chunk[k]);
+            offset[k] = (index % n) * chunk[k];
+            index /= n;
+        }
+
+        return offset;
+    }
+
+private:
+    void run() {
+        std::vector<char> a, b;
+
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                //stay close to the writer, so that memory remains bounded
+                cv_work.wait(lock, [this] {
+                    return stopping || !error.empty() || (next < nchunks && next < written + window);
+                });
+
+                if (stopping || !error.empty()) {
+                    return;
+                }
+
+                index = next++;
+            }
+
+            try {
+                gather(offset_of(index), a);
+                encode(a, b);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (error.empty()) {
+                    error = e.what();
+                }
+                cv_done.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            done[index].swap(a);
+            cv_done.notify_all();
+        }
+    }
+
+    //copies the chunk at offset out of the data, padding edge chunks
+    void gather(const nix::NDSize &offset, std::vector<char> &out) {
+        const size_t rank = chunk.size();
+        out.resize(static_cast<size_t>(chunk.nelms()) * elsize);
+
+        nix::NDSize count(rank);
+        for (size_t k = 0; k < rank; k++) {
+            count[k] = std::min(chunk[k], extent[k] - offset[k]);
+        }
+
+        if (count != chunk) {
+            for (size_t i = 0; i < out.size(); i += elsize) {
+                memcpy(out.data() + i, fill.data(), elsize);
+            }
+        }
+
+        const size_t row = static_cast<size_t>(count[rank - 1]) * elsize;
+        const size_t rows = static_cast<size_t>(count.nelms() / count[rank - 1]);
+
+        nix::NDSize pos(rank, 0);
+        for (size_t r = 0; r < rows; r++) {
+            size_t from = 0, to = 0;
+            for (size_t k = 0; k < rank; k++) {
+                from = from * extent[k] + offset[k] + pos[k];
+                to = to * chunk[k] + pos[k];
+            }
+            memcpy(out.data() + to * elsize, data + from * elsize, row);
+
+            //next row: count up the leading axes
+            for (size_t k = rank - 1; k-- > 0;) {
+                if (++pos[k] < count[k]) {
+                    break;
+                }
+                pos[k] = 0;
+            }
+        }
+    }
+
+    //applies the filters like HDF5 does, leaves the result in `a`
+    void encode(std::vector<char> &a, std::vector<char> &b) {
+        for (const h5_filter &f : filters) {
+            if (f.id == H5Z_FILTER_DEFLATE) {
+                uLongf len = compressBound(static_cast<uLong>(a.size()));
+                b.resize(len);
+                if (compress2(reinterpret_cast<Bytef *>(b.data()), &len,
+                              reinterpret_cast<const Bytef *>(a.data()),
+                              static_cast<uLong>(a.size()), static_cast<int>(f.level)) != Z_OK) {
+                    throw std::runtime_error("could not deflate chunk");
+                }
+                b.resize(len);
+            } else if (elsize > 1) {
+                shuffle(a, b, elsize);
+            } else {
+                continue;
+            }
+
+            a.swap(b);
+        }
+    }
+
+    const std::vector<h5_filter> &filters;
+    size_t elsize;
+    nix::NDSize chunk;
+    nix::NDSize extent;
+    const std::vector<char> &fill;
+    const char *data;
+    size_t nchunks;
+    size_t window;
+
+    std::mutex mtx;
+    std::condition_variable cv_work;
+    std::condition_variable cv_done;
+    std::map<size_t, std::vector<char>> done;
+    size_t next;
+    size_t written;
+    bool stopping;
+    std::string error;
+
+    std::vector<std::thread> workers;
+};
+
+} // namespace
+
+void h5_write_chunks_parallel(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &extent,
+                              const void *data, size_t threads)
+{
+#if H5_VERSION_GE(1, 10, 2)
+    const nix::NDSize chunk = h5_chunk_extent(dset);
+    const size_t rank = chunk.size();
+
+    std::vector<h5_filter> filters;
+    h5_simple_filters(dset, filters);
+
+    //what HDF5 puts into the part of an edge chunk outside the extent
+    std::vector<char> fill(elsize, 0);
+    {
+        h5_id dcpl(H5Dget_create_plist(dset));
+        H5Pget_fill_value(dcpl.get(), memtype, fill.data());
+    }
+
+    size_t nchunks = extent.nelms() > 0 ? 1 : 0;
+    for (size_t k = 0; k < rank; k++) {
+        nchunks *= static_cast<size_t>((extent[k] + chunk[k] - 1) / chunk[k]);
+    }
+
+    chunk_encoder encoder(filters, elsize, chunk, extent, fill, static_cast<const char *>(data),
+                          nchunks, std::max<size_t>(threads, 1));
+
+    std::vector<hsize_t> offset(rank);
+    for (size_t i = 0; i < nchunks; i++) {
+        std::vector<char> encoded = encoder.take(i);
+
+        const nix::NDSize pos = encoder.offset_of(i);
+        std::copy(pos.begin(), pos.end(), offset.begin());
+
+        if (H5Dwrite_chunk(dset, H5P_DEFAULT, 0, offset.data(), encoded.size(), encoded.data()) < 0) {
+            throw std::runtime_error("could not write chunk");
+        }
+    }
+#else
+    throw std::runtime_error("direct chunk writes require HDF5 1.10.2");
+#endif
+}
@@ -0,0 +1,20 @@
+#ifndef NIX_MX_CHUNKWRITE_H
+#define NIX_MX_CHUNKWRITE_H
+
+#include <hdf5.h>
+#include <nix/NDSize.hpp>
+
+/*
+  The counterpart of chunkread.h: a pool of threads cuts the data
+  into chunks and filters them the way HDF5 would, the calling thread
+  stores them in order as they are (direct chunk write, HDF5 1.10.2).
+  The chunks in the file are the same as those of a regular write.
+
+  Supported are the datasets h5_direct_chunks accepts.
+*/
+
+//writes the row-major block `data` to [0, extent) of the dataset
+void h5_write_chunks_parallel(hid_t dset, hid_t memtype, size_t elsize, const nix::NDSize &extent,
+                              const void *data, size_t threads);
+
+#endif
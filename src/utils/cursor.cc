@@ -0,0 +1,134 @@
+#include "cursor.h"
+#include "h5util.h"
+#include "h5select.h"
+#include "transpose.h"
+#include "datatypes.h"
+#include "mkarray.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+struct data_cursor::state {
+    nix::DataArray da;
+    h5_id dset;
+    h5_id memtype;
+    DType2 dtype;
+    bool colmajor;
+
+    //file order
+    nix::NDSize extent;
+    nix::NDSize block;
+    nix::NDSize pos;
+    bool done;
+
+    std::vector<char> buffer;
+};
+
+static nix::NDSize reversed(const nix::NDSize &size)
+{
+    nix::NDSize res = size;
+    std::reverse(res.begin(), res.end());
+    return res;
+}
+
+data_cursor::data_cursor(const nix::DataArray &da, bool colmajor,
+                         const nix::NDSize &extent, const nix::NDSize &block)
+    : st(std::make_shared<state>())
+{
+    st->da = da;
+    st->dset = h5_open_data(da);
+    st->memtype = h5_mem_type(st->dset.get(), da.dataType());
+    st->dtype = dtype_nix2mex(da.dataType());
+    st->colmajor = colmajor;
+    st->extent = extent;
+    st->block = block;
+
+    if (!st->dtype.is_valid) {
+        throw std::domain_error("Unsupported data type");
+    }
+
+    reset();
+}
+
+const data_cursor::state &data_cursor::get() const
+{
+    if (!st) {
+        throw std::runtime_error("cursor has been closed");
+    }
+    return *st;
+}
+
+bool data_cursor::has_next() const
+{
+    return !get().done;
+}
+
+void data_cursor::reset()
+{
+    get();
+    st->pos = nix::NDSize(st->extent.size(), 0);
+    st->done = st->extent.nelms() == 0;
+}
+
+mxArray *data_cursor::next(nix::NDSize &offset)
+{
+    if (!has_next()) {
+        throw std::out_of_range("cursor is exhausted");
+    }
+
+    state &s = *st;
+    const size_t rank = s.extent.size();
+
+    std::vector<hsize_t> h_offset(rank);
+    std::vector<hsize_t> h_count(rank);
+    nix::NDSize count(rank);
+
+    for (size_t i = 0; i < rank; i++) {
+        count[i] = std::min(s.block[i], s.extent[i] - s.pos[i]);
+        h_offset[i] = s.pos[i];
+        h_count[i] = count[i];
+    }
+
+    mxArray *data;
+    if (s.colmajor) {
+        //stored in matlab layout already
+        data = make_mx_array_uninitialized(reversed(count), s.dtype);
+        h5_read_hyperslab(s.dset.get(), s.memtype.get(), h_offset, h_count, mxGetData(data));
+        offset = reversed(s.pos);
+    } else {
+        data = make_mx_array_uninitialized(count, s.dtype);
+        const size_t elsize = mxGetElementSize(data);
+        const size_t nbytes = static_cast<size_t>(count.nelms()) * elsize;
+
+        if (s.buffer.size() < nbytes) {
+            s.buffer.resize(nbytes);
+        }
+
+        h5_read_hyperslab(s.dset.get(), s.memtype.get(), h_offset, h_count, s.buffer.data());
+        transpose_copy(s.buffer.data(), mxGetData(data), elsize, count, colmajor_strides(count));
+        offset = s.pos;
+    }
+
+    //next block, the last axis is contiguous in the file
+    size_t k = rank;
+    while (k-- > 0) {
+        s.pos[k] += s.block[k];
+        if (s.pos[k] < s.extent[k]) {
+            break;
+        }
+        s.pos[k] = 0;
+    }
+
+    s.done = k == static_cast<size_t>(-1);
+    return data;
+}
+
+nix::NDSize data_cursor::extent() const
+{
+    return get().colmajor ? reversed(get().extent) : get().extent;
+}
+
+nix::NDSize data_cursor::block() const
+{
+    return get().colmajor ? reversed(get().block) : get().block;
+}
@@ -0,0 +1,57 @@
+#ifndef NIX_MX_CURSOR_H
+#define NIX_MX_CURSOR_H
+
+#include "handle.h" // will include nix.h, mex.h
+
+#include <memory>
+
+/*
+  Walks the data of a DataArray block by block. Blocks are multiples
+  of the chunk shape of the dataset and aligned to the chunk grid,
+  so no chunk is read (and decompressed) more than once. The dataset
+  stays open and the read buffer is reused for the whole walk.
+
+  Copies share their state, which is what the handles need: they
+  hand out copies of the object they hold.
+*/
+class data_cursor {
+public:
+    data_cursor() { }
+
+    data_cursor(const boost::none_t &) { }
+
+    //extent and block are given in file order
+    data_cursor(const nix::DataArray &da, bool colmajor,
+                const nix::NDSize &extent, const nix::NDSize &block);
+
+    data_cursor &operator=(const boost::none_t &) {
+        st.reset();
+        return *this;
+    }
+
+    explicit operator bool() const {
+        return st != nullptr;
+    }
+
+    bool has_next() const;
+
+    //the next block as a matlab array; offset receives its position
+    //  in the order of the matlab dimensions
+    mxArray *next(nix::NDSize &offset);
+
+    void reset();
+
+    //in the order of the matlab dimensions
+    nix::NDSize extent() const;
+
+    nix::NDSize block() const;
+
+private:
+    struct state;
+
+    const state &get() const;
+
+    std::shared_ptr<state> st;
+};
+
+#endif
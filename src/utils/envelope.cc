@@ -0,0 +1,542 @@
+#include "envelope.h"
+#include "h5select.h"
+#include "calibrate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const char *envelope_name = "nix_mx_envelope";
+
+static const char *axis_attr = "axis";
+
+//values per bin of one level per bin of the next
+static const size_t factor = 8;
+
+//levels are added until the top one has at most that many bins
+static const size_t top_bins = 64;
+
+//elements of a chunk of a level
+static const size_t chunk_elements = 1 << 16;
+
+static const double not_a_number = std::numeric_limits<double>::quiet_NaN();
+
+static size_t div_up(size_t a, size_t b)
+{
+    return (a + b - 1) / b;
+}
+
+//elements before and after the axis
+static void split(const nix::NDSize &extent, size_t axis, size_t &outer, size_t &inner)
+{
+    outer = inner = 1;
+    for (size_t k = 0; k < extent.size(); k++) {
+        if (k < axis) {
+            outer *= static_cast<size_t>(extent[k]);
+        } else if (k > axis) {
+            inner *= static_cast<size_t>(extent[k]);
+        }
+    }
+}
+
+// *** levels ***
+
+struct level {
+    h5_id lo;
+    h5_id hi;
+};
+
+static std::string level_name(const char *kind, size_t k)
+{
+    return kind + std::to_string(k);
+}
+
+static size_t level_count(hid_t env)
+{
+    size_t k = 0;
+    while (H5Lexists(env, level_name("min", k + 1).c_str(), H5P_DEFAULT) > 0) {
+        k++;
+    }
+    return k;
+}
+
+static level open_level(hid_t env, size_t k)
+{
+    level l { h5_id(H5Dopen2(env, level_name("min", k).c_str(), H5P_DEFAULT)),
+              h5_id(H5Dopen2(env, level_name("max", k).c_str(), H5P_DEFAULT)) };
+
+    if (!l.lo.valid() || !l.hi.valid()) {
+        throw std::runtime_error("could not open level " + std::to_string(k) + " of the envelope");
+    }
+    return l;
+}
+
+//the extent of level k (0 is the data itself)
+static nix::NDSize level_extent(const nix::NDSize &extent, size_t axis, size_t k)
+{
+    nix::NDSize res = extent;
+    for (size_t i = 0; i < k; i++) {
+        res[axis] = div_up(static_cast<size_t>(res[axis]), factor);
+    }
+    return res;
+}
+
+static level create_level(hid_t env, size_t k, hid_t ftype, const nix::NDSize &extent, size_t axis)
+{
+    const size_t rank = extent.size();
+    std::vector<hsize_t> dims(extent.begin(), extent.end()), maxdims = dims, chunk(rank);
+    maxdims[axis] = H5S_UNLIMITED;
+
+    //whole rows across the other axes, as far as they fit
+    size_t others = 1;
+    for (size_t i = 0; i < rank; i++) {
+        chunk[i] = std::max<hsize_t>(1, std::min<hsize_t>(dims[i], chunk_elements / others));
+        if (i != axis) {
+            others *= static_cast<size_t>(chunk[i]);
+        }
+    }
+    chunk[axis] = std::max<hsize_t>(1, chunk_elements / others);
+
+    h5_id space(H5Screate_simple(static_cast<int>(rank), dims.data(), maxdims.data()));
+    h5_id dcpl(H5Pcreate(H5P_DATASET_CREATE));
+    H5Pset_chunk(dcpl.get(), static_cast<int>(rank), chunk.data());
+
+    level l { h5_id(H5Dcreate2(env, level_name("min", k).c_str(), ftype, space.get(), H5P_DEFAULT,
+                               dcpl.get(), H5P_DEFAULT)),
+              h5_id(H5Dcreate2(env, level_name("max", k).c_str(), ftype, space.get(), H5P_DEFAULT,
+                               dcpl.get(), H5P_DEFAULT)) };
+
+    if (!l.lo.valid() || !l.hi.valid()) {
+        throw std::runtime_error("could not create level " + std::to_string(k) + " of the envelope");
+    }
+    return l;
+}
+
+static void resize_level(const level &l, const nix::NDSize &extent)
+{
+    std::vector<hsize_t> dims(extent.begin(), extent.end());
+    if (H5Dset_extent(l.lo.get(), dims.data()) < 0 || H5Dset_extent(l.hi.get(), dims.data()) < 0) {
+        throw std::runtime_error("could not resize the envelope");
+    }
+}
+
+//the block [first, first + n) along the axis over all other axes
+static void select(const nix::NDSize &extent, size_t axis, size_t first, size_t n,
+                   std::vector<hsize_t> &offset, std::vector<hsize_t> &count)
+{
+    offset.assign(extent.size(), 0);
+    count.assign(extent.begin(), extent.end());
+    offset[axis] = first;
+    count[axis] = n;
+}
+
+// *** bins ***
+
+//the smaller of two values; NaN only if both are
+template<typename T>
+static inline T min_of(T a, T v)
+{
+    return (v < a || a != a) ? v : a;
+}
+
+template<typename T>
+static inline T max_of(T a, T v)
+{
+    return (v > a || a != a) ? v : a;
+}
+
+/*
+  Bins of `factor` values along the axis of the blocks lo and hi
+  ([outer, len, inner], the same block for the data), whose first
+  value is number start along the axis. The bins, from start / factor
+  on, go to out_lo and out_hi as [outer, nbins, inner].
+*/
+template<typename T>
+static void bin(const void *lo_in, const void *hi_in, size_t outer, size_t len, size_t inner, size_t start,
+                void *lo_out, void *hi_out)
+{
+    const T *lo = static_cast<const T *>(lo_in);
+    const T *hi = static_cast<const T *>(hi_in);
+    T *out_lo = static_cast<T *>(lo_out);
+    T *out_hi = static_cast<T *>(hi_out);
+
+    const size_t first = start / factor;
+    const size_t nbins = div_up(start + len, factor) - first;
+
+    for (size_t o = 0; o < outer; o++) {
+        for (size_t b = 0; b < nbins; b++) {
+            const size_t from = std::max(start, (first + b) * factor) - start;
+            const size_t to = std::min(start + len, (first + b + 1) * factor) - start;
+
+            T *l = out_lo + (o * nbins + b) * inner;
+            T *h = out_hi + (o * nbins + b) * inner;
+            std::copy(lo + (o * len + from) * inner, lo + (o * len + from + 1) * inner, l);
+            std::copy(hi + (o * len + from) * inner, hi + (o * len + from + 1) * inner, h);
+
+            for (size_t i = from + 1; i < to; i++) {
+                const T *rl = lo + (o * len + i) * inner;
+                const T *rh = hi + (o * len + i) * inner;
+                for (size_t j = 0; j < inner; j++) {
+                    l[j] = min_of(l[j], rl[j]);
+                    h[j] = max_of(h[j], rh[j]);
+                }
+            }
+        }
+    }
+}
+
+//merges the bins old (n values each) into lo and hi
+template<typename T>
+static void merge(const void *old_lo, const void *old_hi, size_t n, void *lo, void *hi)
+{
+    const T *ol = static_cast<const T *>(old_lo);
+    const T *oh = static_cast<const T *>(old_hi);
+    T *l = static_cast<T *>(lo);
+    T *h = static_cast<T *>(hi);
+
+    for (size_t i = 0; i < n; i++) {
+        l[i] = min_of(l[i], ol[i]);
+        h[i] = max_of(h[i], oh[i]);
+    }
+}
+
+static void bin_any(nix::DataType dtype, const void *lo, const void *hi, size_t outer, size_t len,
+                    size_t inner, size_t start, void *out_lo, void *out_hi)
+{
+    switch (dtype) {
+    case nix::DataType::Float: bin<float>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::Double: bin<double>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::Int8: bin<int8_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::Int16: bin<int16_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::Int32: bin<int32_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::Int64: bin<int64_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::UInt8: bin<uint8_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::UInt16: bin<uint16_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::UInt32: bin<uint32_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    case nix::DataType::UInt64: bin<uint64_t>(lo, hi, outer, len, inner, start, out_lo, out_hi); break;
+    default: throw std::domain_error("envelopes require numeric data");
+    }
+}
+
+static void merge_any(nix::DataType dtype, const void *old_lo, const void *old_hi, size_t n, void *lo, void *hi)
+{
+    switch (dtype) {
+    case nix::DataType::Float: merge<float>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::Double: merge<double>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::Int8: merge<int8_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::Int16: merge<int16_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::Int32: merge<int32_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::Int64: merge<int64_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::UInt8: merge<uint8_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::UInt16: merge<uint16_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::UInt32: merge<uint32_t>(old_lo, old_hi, n, lo, hi); break;
+    case nix::DataType::UInt64: merge<uint64_t>(old_lo, old_hi, n, lo, hi); break;
+    default: throw std::domain_error("envelopes require numeric data");
+    }
+}
+
+/*
+  Recomputes the bins of dst over the values [first, last) along the
+  axis of src_lo and src_hi (the same dataset for the data), whose
+  extent is src_extent, reading at most block_bytes at a time.
+*/
+static void update_level(hid_t src_lo, hid_t src_hi, const level &dst, nix::DataType dtype,
+                         const nix::NDSize &src_extent, size_t axis, size_t first, size_t last,
+                         size_t block_bytes)
+{
+    //whole bins
+    const size_t n = std::min(div_up(last, factor) * factor, static_cast<size_t>(src_extent[axis]));
+    if (first >= n) {
+        return;
+    }
+
+    size_t outer, inner;
+    split(src_extent, axis, outer, inner);
+
+    h5_id memtype = h5_mem_type(src_lo, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+    const size_t row = outer * inner * elsize;
+    const size_t step = std::max(factor, block_bytes / std::max<size_t>(1, row) / factor * factor);
+
+    std::vector<char> lo, hi, out_lo, out_hi;
+    std::vector<hsize_t> offset, count;
+
+    for (size_t from = first / factor * factor; from < n; from += step) {
+        const size_t len = std::min(step, n - from);
+        select(src_extent, axis, from, len, offset, count);
+
+        lo.resize(len * row);
+        h5_read_hyperslab(src_lo, memtype.get(), offset, count, lo.data());
+        if (src_hi != src_lo) {
+            hi.resize(len * row);
+            h5_read_hyperslab(src_hi, memtype.get(), offset, count, hi.data());
+        }
+
+        const size_t nbins = div_up(len, factor);
+        out_lo.resize(nbins * row);
+        out_hi.resize(nbins * row);
+        bin_any(dtype, lo.data(), src_hi != src_lo ? hi.data() : lo.data(), outer, len, inner, from,
+                out_lo.data(), out_hi.data());
+
+        select(src_extent, axis, from / factor, nbins, offset, count);
+        h5_write_hyperslab(dst.lo.get(), memtype.get(), offset, count, out_lo.data());
+        h5_write_hyperslab(dst.hi.get(), memtype.get(), offset, count, out_hi.data());
+    }
+}
+
+//adds levels on top of the levels until the top one has few bins
+static void add_levels(hid_t env, hid_t dset, nix::DataType dtype, const nix::NDSize &extent, size_t axis,
+                       size_t levels, size_t block_bytes)
+{
+    h5_id ftype(H5Dget_type(dset));
+
+    while (levels == 0 || level_extent(extent, axis, levels)[axis] > top_bins) {
+        const nix::NDSize src_extent = level_extent(extent, axis, levels);
+        level dst = create_level(env, levels + 1, ftype.get(), level_extent(extent, axis, levels + 1), axis);
+
+        if (levels == 0) {
+            update_level(dset, dset, dst, dtype, src_extent, axis, 0, src_extent[axis], block_bytes);
+        } else {
+            level src = open_level(env, levels);
+            update_level(src.lo.get(), src.hi.get(), dst, dtype, src_extent, axis, 0, src_extent[axis], block_bytes);
+        }
+
+        levels++;
+    }
+}
+
+// *** public ***
+
+bool h5_has_envelope(hid_t group)
+{
+    return H5Lexists(group, envelope_name, H5P_DEFAULT) > 0;
+}
+
+size_t h5_envelope_axis(hid_t group)
+{
+    h5_id env(H5Gopen2(group, envelope_name, H5P_DEFAULT));
+    h5_id attr(H5Aopen(env.get(), axis_attr, H5P_DEFAULT));
+
+    uint64_t axis = 0;
+    if (!attr.valid() || H5Aread(attr.get(), H5T_NATIVE_UINT64, &axis) < 0) {
+        throw std::runtime_error("the envelope has no valid axis");
+    }
+    return static_cast<size_t>(axis);
+}
+
+void h5_drop_envelope(hid_t group)
+{
+    if (h5_has_envelope(group) && H5Ldelete(group, envelope_name, H5P_DEFAULT) < 0) {
+        throw std::runtime_error("could not remove the envelope");
+    }
+}
+
+void h5_build_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                       size_t axis, size_t block_bytes)
+{
+    if (axis >= extent.size()) {
+        throw std::invalid_argument("the axis of the envelope exceeds the rank of the data");
+    }
+
+    h5_drop_envelope(group);
+    h5_id env(H5Gcreate2(group, envelope_name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+
+    const uint64_t value = axis;
+    h5_id space(H5Screate(H5S_SCALAR));
+    h5_id attr(H5Acreate2(env.get(), axis_attr, H5T_STD_U64LE, space.get(), H5P_DEFAULT, H5P_DEFAULT));
+
+    if (!env.valid() || !attr.valid() || H5Awrite(attr.get(), H5T_NATIVE_UINT64, &value) < 0) {
+        throw std::runtime_error("could not create the envelope");
+    }
+
+    add_levels(env.get(), dset, dtype, extent, axis, 0, block_bytes);
+}
+
+void h5_refresh_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                         size_t first, size_t last, size_t block_bytes)
+{
+    const size_t axis = h5_envelope_axis(group);
+    h5_id env(H5Gopen2(group, envelope_name, H5P_DEFAULT));
+    const size_t levels = level_count(env.get());
+
+    for (size_t k = 1; k <= levels; k++) {
+        const nix::NDSize src_extent = level_extent(extent, axis, k - 1);
+        level dst = open_level(env.get(), k);
+        resize_level(dst, level_extent(extent, axis, k));
+
+        if (k == 1) {
+            update_level(dset, dset, dst, dtype, src_extent, axis, first, last, block_bytes);
+        } else {
+            level src = open_level(env.get(), k - 1);
+            update_level(src.lo.get(), src.hi.get(), dst, dtype, src_extent, axis, first, last, block_bytes);
+        }
+
+        //the bins of this level that changed
+        first /= factor;
+        last = div_up(last, factor);
+    }
+
+    add_levels(env.get(), dset, dtype, extent, axis, levels, block_bytes);
+}
+
+void h5_append_envelope(hid_t group, hid_t dset, nix::DataType stored, nix::DataType dtype,
+                        const void *data, const nix::NDSize &count, size_t previous,
+                        const nix::NDSize &extent, size_t block_bytes)
+{
+    const size_t axis = h5_envelope_axis(group);
+    h5_id env(H5Gopen2(group, envelope_name, H5P_DEFAULT));
+    const size_t levels = level_count(env.get());
+
+    size_t outer, inner;
+    split(count, axis, outer, inner);
+    const size_t elsize = nix::data_type_to_size(stored);
+    size_t len = static_cast<size_t>(count[axis]);
+
+    //the values as they are stored
+    std::vector<char> converted;
+    const void *values = data;
+    if (stored != dtype) {
+        const size_t n = static_cast<size_t>(count.nelms());
+        converted.resize(n * std::max(elsize, nix::data_type_to_size(dtype)));
+        memcpy(converted.data(), data, n * nix::data_type_to_size(dtype));
+
+        h5_id src = h5_mem_type(dset, dtype);
+        h5_id dst = h5_mem_type(dset, stored);
+        if (H5Tconvert(src.get(), dst.get(), n, converted.data(), nullptr, H5P_DEFAULT) < 0) {
+            throw std::runtime_error("could not convert the appended data");
+        }
+        values = converted.data();
+    }
+
+    h5_id memtype = h5_mem_type(dset, stored);
+    std::vector<char> lo_in, hi_in, lo, hi, old_lo, old_hi;
+    const void *src_lo = values, *src_hi = values;
+    size_t start = previous;
+
+    for (size_t k = 1; k <= levels; k++) {
+        const size_t nbins = div_up(start + len, factor) - start / factor;
+        lo.resize(outer * nbins * inner * elsize);
+        hi.resize(lo.size());
+        bin_any(stored, src_lo, src_hi, outer, len, inner, start, lo.data(), hi.data());
+
+        level dst = open_level(env.get(), k);
+        resize_level(dst, level_extent(extent, axis, k));
+
+        std::vector<hsize_t> offset, cnt;
+        nix::NDSize bins = count;
+
+        //the first bin also holds values from before
+        if (start % factor != 0) {
+            bins[axis] = 1;
+            select(bins, axis, start / factor, 1, offset, cnt);
+            old_lo.resize(outer * inner * elsize);
+            old_hi.resize(old_lo.size());
+            h5_read_hyperslab(dst.lo.get(), memtype.get(), offset, cnt, old_lo.data());
+            h5_read_hyperslab(dst.hi.get(), memtype.get(), offset, cnt, old_hi.data());
+
+            for (size_t o = 0; o < outer; o++) {
+                const size_t at = o * nbins * inner * elsize;
+                merge_any(stored, old_lo.data() + o * inner * elsize, old_hi.data() + o * inner * elsize,
+                          inner, lo.data() + at, hi.data() + at);
+            }
+        }
+
+        bins[axis] = nbins;
+        select(bins, axis, start / factor, nbins, offset, cnt);
+        h5_write_hyperslab(dst.lo.get(), memtype.get(), offset, cnt, lo.data());
+        h5_write_hyperslab(dst.hi.get(), memtype.get(), offset, cnt, hi.data());
+
+        //the bins are complete and feed the next level
+        lo_in.swap(lo);
+        hi_in.swap(hi);
+        src_lo = lo_in.data();
+        src_hi = hi_in.data();
+        start /= factor;
+        len = nbins;
+    }
+
+    add_levels(env.get(), dset, stored, extent, axis, levels, block_bytes);
+}
+
+size_t h5_read_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                        size_t first, size_t last, size_t npix, double *lo, double *hi)
+{
+    if (!h5_has_envelope(group)) {
+        throw std::runtime_error("the data has no envelope");
+    }
+
+    h5_id env(H5Gopen2(group, envelope_name, H5P_DEFAULT));
+    const size_t axis = h5_envelope_axis(group);
+    const size_t levels = level_count(env.get());
+
+    size_t outer, inner;
+    split(extent, axis, outer, inner);
+    last = std::min(last, static_cast<size_t>(extent[axis]));
+    first = std::min(first, last);
+
+    //the coarsest level with two bins per pixel
+    size_t k = 0, width = 1;
+    while (k < levels && (last - first) / (width * factor) >= 2 * npix) {
+        k++;
+        width *= factor;
+    }
+
+    const size_t b0 = first / width;
+    const size_t b1 = div_up(last, width);
+    const size_t n = (b1 - b0) * outer * inner;
+    const size_t elsize = nix::data_type_to_size(dtype);
+
+    std::vector<char> raw(n * elsize);
+    std::vector<double> blo(n), bhi(n);
+    std::vector<hsize_t> offset, count;
+    select(extent, axis, b0, b1 - b0, offset, count);
+    h5_id memtype = h5_mem_type(dset, dtype);
+
+    if (n > 0 && k == 0) {
+        h5_read_hyperslab(dset, memtype.get(), offset, count, raw.data());
+        apply_polynomial(polynomial(), dtype, raw.data(), n, false, blo.data());
+        bhi = blo;
+    } else if (n > 0) {
+        level l = open_level(env.get(), k);
+        h5_read_hyperslab(l.lo.get(), memtype.get(), offset, count, raw.data());
+        apply_polynomial(polynomial(), dtype, raw.data(), n, false, blo.data());
+        h5_read_hyperslab(l.hi.get(), memtype.get(), offset, count, raw.data());
+        apply_polynomial(polynomial(), dtype, raw.data(), n, false, bhi.data());
+    }
+
+    //pixel p takes the values [first + p * w, first + (p + 1) * w)
+    const size_t nb = b1 - b0;
+    const double w = static_cast<double>(last - first) / npix;
+
+    for (size_t p = 0; p < npix; p++) {
+        const size_t from = first + static_cast<size_t>(std::floor(p * w));
+        const size_t to = p + 1 == npix ? last : first + static_cast<size_t>(std::floor((p + 1) * w));
+
+        for (size_t o = 0; o < outer; o++) {
+            double *l = lo + (o * npix + p) * inner;
+            double *h = hi + (o * npix + p) * inner;
+            std::fill(l, l + inner, not_a_number);
+            std::fill(h, h + inner, not_a_number);
+
+            if (to <= from) {
+                continue;
+            }
+
+            for (size_t b = from / width; b < div_up(to, width); b++) {
+                const double *rl = blo.data() + (o * nb + b - b0) * inner;
+                const double *rh = bhi.data() + (o * nb + b - b0) * inner;
+                for (size_t j = 0; j < inner; j++) {
+                    l[j] = min_of(l[j], rl[j]);
+                    h[j] = max_of(h[j], rh[j]);
+                }
+            }
+        }
+    }
+
+    return k;
+}
@@ -0,0 +1,59 @@
+#ifndef NIX_MX_ENVELOPE_H
+#define NIX_MX_ENVELOPE_H
+
+#include "h5util.h"
+
+#include <hdf5.h>
+#include <nix/DataType.hpp>
+#include <nix/NDSize.hpp>
+
+/*
+  Envelope pyramids: the minima and maxima of the data along one axis
+  in bins of 8, 64, 512, ... values, for plotting long recordings at
+  a resolution that matches the screen. Level k holds bins of 8^k
+  values as the datasets min<k> and max<k> of the stored type, laid
+  out like the data with the axis shortened, in the group
+  envelope_name next to the data; levels are added until the top
+  one has few bins. NaN is left out of the bins.
+
+  Level k is computed from level k - 1 (the data for k = 1), so
+  updating a range of the data touches 1/8 as many bins per level.
+  Appends are merged from the appended values, without reading the
+  data back.
+*/
+
+extern const char *envelope_name;
+
+bool h5_has_envelope(hid_t group);
+
+//the axis (file order) the envelope runs along
+size_t h5_envelope_axis(hid_t group);
+
+//reads the dataset dset of the numeric type dtype within extent and
+//  stores the envelope along axis, replacing an existing one; at most
+//  block_bytes are read at a time
+void h5_build_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                       size_t axis, size_t block_bytes);
+
+void h5_drop_envelope(hid_t group);
+
+//recomputes the bins over [first, last) along the axis from dset,
+//  which has the given extent now
+void h5_refresh_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                         size_t first, size_t last, size_t block_bytes);
+
+//merges the row-major block of dtype, appended to dset of type stored
+//  at previous along the axis, into the envelope
+void h5_append_envelope(hid_t group, hid_t dset, nix::DataType stored, nix::DataType dtype,
+                        const void *data, const nix::NDSize &count, size_t previous,
+                        const nix::NDSize &extent, size_t block_bytes);
+
+//minima and maxima of the values [first, last) along the axis in
+//  npix pixels of equal width; lo and hi are row-major in file order
+//  with npix along the axis, NaN for pixels without values. Reads
+//  the coarsest level with at least two bins per pixel, so a pixel
+//  may take up to one bin more on either side. Returns that level.
+size_t h5_read_envelope(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                        size_t first, size_t last, size_t npix, double *lo, double *hi);
+
+#endif
@@ -0,0 +1,105 @@
+#include "flusher.h"
+
+#include <stdexcept>
+
+//how often a waiting worker checks whether it is still wanted
+static const std::chrono::milliseconds poll_interval(10);
+
+swmr_flusher::swmr_flusher(hid_t file, const std::string &name, size_t every,
+                           std::chrono::milliseconds interval)
+    : file(file), name(name), every(every), interval(interval), pending(0), stopping(false)
+{
+    if (interval.count() > 0) {
+        worker = std::thread(&swmr_flusher::run, this);
+    }
+}
+
+swmr_flusher::~swmr_flusher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+
+    cv.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    //what readers have not seen yet goes out with the final flush
+    std::lock_guard<std::mutex> lock(mtx);
+    if (pending > 0) {
+        try {
+            h5_flush_file(file);
+        } catch (const std::runtime_error &) {
+            //nobody is left to report to
+        }
+    }
+}
+
+void swmr_flusher::appended()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    pending++;
+
+    if (every > 0 && pending >= every) {
+        flush_locked();
+    } else if (pending == 1) {
+        cv.notify_all();
+    }
+}
+
+void swmr_flusher::flush()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    flush_locked();
+}
+
+void swmr_flusher::flush_locked()
+{
+    h5_flush_file(file);
+    pending = 0;
+}
+
+void swmr_flusher::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+        cv.wait(lock, [this] { return stopping || pending > 0; });
+
+        //the first unflushed append starts the clock
+        if (cv.wait_for(lock, interval, [this] { return stopping; })) {
+            return;
+        }
+
+        if (pending == 0) {
+            continue;
+        }
+
+        //wait for the current command to finish
+        std::unique_lock<std::timed_mutex> h5(h5_mutex(), std::defer_lock);
+        bool locked = false;
+
+        while (!locked && !stopping) {
+            lock.unlock();
+            locked = h5.try_lock_for(poll_interval);
+            lock.lock();
+        }
+
+        if (!locked) {
+            return;
+        }
+
+        //errors show up again with the next flush of a command
+        try {
+            if (pending > 0) {
+                h5_flush_file(file);
+                pending = 0;
+            }
+        } catch (const std::runtime_error &) {
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef NIX_MX_FLUSHER_H
+#define NIX_MX_FLUSHER_H
+
+#include "h5util.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+  Flush policy of a file written in SWMR mode: readers only see what
+  has been flushed. The file is flushed every `every` appends and, by
+  a worker thread, `interval` after the first append that has not been
+  flushed yet; with neither, only flush() does.
+
+  Members must be called with h5_mutex held (as every command does),
+  the worker takes it for its flushes.
+*/
+class swmr_flusher {
+public:
+    swmr_flusher(hid_t file, const std::string &name, size_t every,
+                 std::chrono::milliseconds interval);
+
+    ~swmr_flusher();
+
+    swmr_flusher(const swmr_flusher &other) = delete;
+    swmr_flusher &operator=(const swmr_flusher &other) = delete;
+
+    const std::string &file_name() const {
+        return name;
+    }
+
+    //an append has been written (or queued to be written)
+    void appended();
+
+    void flush();
+
+private:
+    void run();
+
+    //with mtx held
+    void flush_locked();
+
+    hid_t file;
+    std::string name;
+    size_t every;
+    std::chrono::milliseconds interval;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    size_t pending;
+    bool stopping;
+
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include "h5select.h"
+#include "h5util.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+//HDF5 merges unions of hyperslabs one by one, past this number
+// of them it is cheaper to read the span of an axis and drop
+// what was not asked for
+static const size_t max_hyperslabs = 1024;
+
+//an axis is read as a whole span if at least this fraction is wanted
+static const double span_density = 0.5;
+
+namespace {
+
+    struct pattern {
+        hsize_t start;
+        hsize_t stride;
+        hsize_t count;
+        hsize_t block;
+    };
+
+    //the coordinates read along one axis and the patterns selecting them
+    struct axis_plan {
+        std::vector<hsize_t> coords;
+        std::vector<pattern> patterns;
+    };
+
+}
+
+static std::vector<pattern> make_patterns(const std::vector<hsize_t> &coords)
+{
+    std::vector<pattern> res;
+
+    size_t i = 0;
+    while (i < coords.size()) {
+        //the next run of consecutive coordinates
+        size_t j = i + 1;
+        while (j < coords.size() && coords[j] == coords[j - 1] + 1) {
+            j++;
+        }
+
+        const hsize_t start = coords[i];
+        const hsize_t block = static_cast<hsize_t>(j - i);
+
+        if (!res.empty()) {
+            pattern &last = res.back();
+            const hsize_t next = last.start + last.count * last.stride;
+
+            if (last.block == block && last.count == 1) {
+                last.stride = start - last.start;
+                last.count = 2;
+                i = j;
+                continue;
+            }
+
+            if (last.block == block && start == next) {
+                last.count++;
+                i = j;
+                continue;
+            }
+        }
+
+        res.push_back(pattern { start, block, 1, block });
+        i = j;
+    }
+
+    return res;
+}
+
+static void read_span(axis_plan &plan)
+{
+    const hsize_t first = plan.coords.front();
+    const hsize_t n = plan.coords.back() - first + 1;
+
+    plan.coords.resize(static_cast<size_t>(n));
+    std::iota(plan.coords.begin(), plan.coords.end(), first);
+    plan.patterns.assign(1, pattern { first, n, 1, n });
+}
+
+static std::vector<axis_plan> make_plans(const std::vector<std::vector<hsize_t>> &index)
+{
+    std::vector<axis_plan> plans(index.size());
+
+    for (size_t k = 0; k < index.size(); k++) {
+        axis_plan &plan = plans[k];
+        plan.coords = index[k];
+        std::sort(plan.coords.begin(), plan.coords.end());
+        plan.coords.erase(std::unique(plan.coords.begin(), plan.coords.end()), plan.coords.end());
+        plan.patterns = make_patterns(plan.coords);
+
+        const double span = static_cast<double>(plan.coords.back() - plan.coords.front() + 1);
+        if (plan.patterns.size() > 1 && plan.coords.size() >= span_density * span) {
+            read_span(plan);
+        }
+    }
+
+    //keep the number of hyperslabs in check
+    while (true) {
+        size_t total = 1;
+        size_t widest = 0;
+
+        for (size_t k = 0; k < plans.size(); k++) {
+            total *= plans[k].patterns.size();
+            if (plans[k].patterns.size() > plans[widest].patterns.size()) {
+                widest = k;
+            }
+        }
+
+        if (total <= max_hyperslabs || plans[widest].patterns.size() == 1) {
+            break;
+        }
+
+        read_span(plans[widest]);
+    }
+
+    return plans;
+}
+
+//selects the cartesian product of the patterns of all axes
+static void select_plans(hid_t space, const std::vector<axis_plan> &plans)
+{
+    const size_t rank = plans.size();
+    std::vector<size_t> idx(rank, 0);
+    std::vector<hsize_t> start(rank), stride(rank), count(rank), block(rank);
+    H5S_seloper_t op = H5S_SELECT_SET;
+
+    while (true) {
+        for (size_t k = 0; k < rank; k++) {
+            const pattern &p = plans[k].patterns[idx[k]];
+            start[k] = p.start;
+            stride[k] = p.stride;
+            count[k] = p.count;
+            block[k] = p.block;
+        }
+
+        if (H5Sselect_hyperslab(space, op, start.data(), stride.data(), count.data(), block.data()) < 0) {
+            throw std::runtime_error("could not select hyperslab");
+        }
+        op = H5S_SELECT_OR;
+
+        size_t k = rank;
+        while (k-- > 0) {
+            if (++idx[k] < plans[k].patterns.size()) {
+                break;
+            }
+            idx[k] = 0;
+        }
+
+        if (k == static_cast<size_t>(-1)) {
+            break;
+        }
+    }
+}
+
+static void read_selection(hid_t dset, hid_t memtype, hid_t filespace,
+                           const std::vector<hsize_t> &shape, void *buf)
+{
+    h5_id memspace(H5Screate_simple(static_cast<int>(shape.size()), shape.data(), nullptr));
+
+    if (H5Dread(dset, memtype, memspace.get(), filespace, H5P_DEFAULT, buf) < 0) {
+        throw std::runtime_error("could not read the selection");
+    }
+}
+
+template<typename T>
+static void gather(const T *src, T *dst, const std::vector<std::vector<size_t>> &pos,
+                   const std::vector<size_t> &src_strides, const std::vector<size_t> &dst_strides)
+{
+    const size_t rank = pos.size();
+    const size_t last = rank - 1;
+    const std::vector<size_t> &inner = pos[last];
+
+    std::vector<size_t> idx(rank, 0);
+    size_t src_base = 0;
+    size_t dst_base = 0;
+
+    for (size_t k = 0; k < last; k++) {
+        src_base += pos[k][0] * src_strides[k];
+    }
+
+    while (true) {
+        for (size_t j = 0; j < inner.size(); j++) {
+            dst[dst_base + j * dst_strides[last]] = src[src_base + inner[j] * src_strides[last]];
+        }
+
+        size_t k = last;
+        while (k-- > 0) {
+            src_base -= pos[k][idx[k]] * src_strides[k];
+            dst_base -= idx[k] * dst_strides[k];
+
+            if (++idx[k] < pos[k].size()) {
+                src_base += pos[k][idx[k]] * src_strides[k];
+                dst_base += idx[k] * dst_strides[k];
+                break;
+            }
+
+            idx[k] = 0;
+            src_base += pos[k][0] * src_strides[k];
+        }
+
+        if (k == static_cast<size_t>(-1)) {
+            break;
+        }
+    }
+}
+
+template<typename T>
+static void gather_points(const T *src, T *dst, const std::vector<size_t> &pos)
+{
+    for (size_t i = 0; i < pos.size(); i++) {
+        dst[i] = src[pos[i]];
+    }
+}
+
+void h5_read_indexed(hid_t dset, hid_t memtype, size_t elsize,
+                     const std::vector<std::vector<hsize_t>> &index,
+                     void *out, const std::vector<size_t> &dst_strides)
+{
+    const size_t rank = index.size();
+
+    for (size_t k = 0; k < rank; k++) {
+        if (index[k].empty()) {
+            return;
+        }
+    }
+
+    std::vector<axis_plan> plans = make_plans(index);
+
+    h5_id filespace(H5Dget_space(dset));
+    select_plans(filespace.get(), plans);
+
+    std::vector<hsize_t> shape(rank);
+    size_t nelms = 1;
+    for (size_t k = 0; k < rank; k++) {
+        shape[k] = static_cast<hsize_t>(plans[k].coords.size());
+        nelms *= plans[k].coords.size();
+    }
+
+    std::vector<char> buf(nelms * elsize);
+    read_selection(dset, memtype, filespace.get(), shape, buf.data());
+
+    //where each requested index ended up in the buffer
+    std::vector<std::vector<size_t>> pos(rank);
+    std::vector<size_t> src_strides(rank);
+    size_t stride = 1;
+
+    for (size_t k = rank; k-- > 0;) {
+        const std::vector<hsize_t> &coords = plans[k].coords;
+        pos[k].resize(index[k].size());
+
+        for (size_t j = 0; j < index[k].size(); j++) {
+            auto it = std::lower_bound(coords.begin(), coords.end(), index[k][j]);
+            pos[k][j] = static_cast<size_t>(it - coords.begin());
+        }
+
+        src_strides[k] = stride;
+        stride *= coords.size();
+    }
+
+    switch (elsize) {
+    case 1: gather(reinterpret_cast<const uint8_t *>(buf.data()), static_cast<uint8_t *>(out), pos, src_strides, dst_strides); break;
+    case 2: gather(reinterpret_cast<const uint16_t *>(buf.data()), static_cast<uint16_t *>(out), pos, src_strides, dst_strides); break;
+    case 4: gather(reinterpret_cast<const uint32_t *>(buf.data()), static_cast<uint32_t *>(out), pos, src_strides, dst_strides); break;
+    case 8: gather(reinterpret_cast<const uint64_t *>(buf.data()), static_cast<uint64_t *>(out), pos, src_strides, dst_strides); break;
+    default: throw std::invalid_argument("unsupported element size for indexed reads");
+    }
+}
+
+void h5_read_points(hid_t dset, hid_t memtype, size_t elsize,
+                    const std::vector<hsize_t> &coords, size_t rank, void *out)
+{
+    const size_t n = rank > 0 ? coords.size() / rank : 0;
+    if (n == 0) {
+        return;
+    }
+
+    //visit the points in file order, which keeps chunk access local
+    auto less = [&](size_t a, size_t b) {
+        return std::lexicographical_compare(coords.begin() + a * rank, coords.begin() + (a + 1) * rank,
+                                            coords.begin() + b * rank, coords.begin() + (b + 1) * rank);
+    };
+    auto same = [&](size_t a, size_t b) {
+        return std::equal(coords.begin() + a * rank, coords.begin() + (a + 1) * rank, coords.begin() + b * rank);
+    };
+
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), less);
+
+    std::vector<size_t> uniq;
+    std::vector<size_t> pos(n);
+    for (size_t i = 0; i < n; i++) {
+        if (uniq.empty() || !same(uniq.back(), order[i])) {
+            uniq.push_back(order[i]);
+        }
+        pos[order[i]] = uniq.size() - 1;
+    }
+
+    //runs of points next to each other along the last axis
+    std::vector<std::pair<size_t, hsize_t>> runs;
+    for (size_t i = 0; i < uniq.size(); i++) {
+        if (!runs.empty()) {
+            const size_t first = runs.back().first;
+            const hsize_t len = runs.back().second;
+            const bool adjacent = std::equal(coords.begin() + first * rank, coords.begin() + first * rank + rank - 1,
+                                             coords.begin() + uniq[i] * rank) &&
+                coords[uniq[i] * rank + rank - 1] == coords[first * rank + rank - 1] + len;
+
+            if (adjacent) {
+                runs.back().second++;
+                continue;
+            }
+        }
+        runs.push_back(std::make_pair(uniq[i], hsize_t(1)));
+    }
+
+    h5_id filespace(H5Dget_space(dset));
+
+    if (runs.size() <= max_hyperslabs && runs.size() * 2 <= uniq.size()) {
+        std::vector<hsize_t> count(rank, 1);
+        std::vector<hsize_t> block(rank, 1);
+        H5S_seloper_t op = H5S_SELECT_SET;
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            block[rank - 1] = runs[i].second;
+            if (H5Sselect_hyperslab(filespace.get(), op, &coords[runs[i].first * rank],
+                                    nullptr, count.data(), block.data()) < 0) {
+                throw std::runtime_error("could not select hyperslab");
+            }
+            op = H5S_SELECT_OR;
+        }
+    } else {
+        std::vector<hsize_t> points(uniq.size() * rank);
+        for (size_t i = 0; i < uniq.size(); i++) {
+            std::copy(coords.begin() + uniq[i] * rank, coords.begin() + (uniq[i] + 1) * rank,
+                      points.begin() + i * rank);
+        }
+
+        if (H5Sselect_elements(filespace.get(), H5S_SELECT_SET, uniq.size(), points.data()) < 0) {
+            throw std::runtime_error("could not select points");
+        }
+    }
+
+    std::vector<char> buf(uniq.size() * elsize);
+    read_selection(dset, memtype, filespace.get(), std::vector<hsize_t>(1, uniq.size()), buf.data());
+
+    switch (elsize) {
+    case 1: gather_points(reinterpret_cast<const uint8_t *>(buf.data()), static_cast<uint8_t *>(out), pos); break;
+    case 2: gather_points(reinterpret_cast<const uint16_t *>(buf.data()), static_cast<uint16_t *>(out), pos); break;
+    case 4: gather_points(reinterpret_cast<const uint32_t *>(buf.data()), static_cast<uint32_t *>(out), pos); break;
+    case 8: gather_points(reinterpret_cast<const uint64_t *>(buf.data()), static_cast<uint64_t *>(out), pos); break;
+    default: throw std::invalid_argument("unsupported element size for indexed reads");
+    }
+}
+
+void h5_read_hyperslab(hid_t dset, hid_t memtype, const std::vector<hsize_t> &offset,
+                       const std::vector<hsize_t> &count, void *buf)
+{
+    h5_id filespace(H5Dget_space(dset));
+    if (H5Sselect_hyperslab(filespace.get(), H5S_SELECT_SET, offset.data(), nullptr,
+                            count.data(), nullptr) < 0) {
+        throw std::runtime_error("could not select hyperslab");
+    }
+
+    read_selection(dset, memtype, filespace.get(), count, buf);
+}
+
+void h5_write_hyperslab(hid_t dset, hid_t memtype, const std::vector<hsize_t> &offset,
+                        const std::vector<hsize_t> &count, const void *buf)
+{
+    h5_id filespace(H5Dget_space(dset));
+    if (H5Sselect_hyperslab(filespace.get(), H5S_SELECT_SET, offset.data(), nullptr,
+                            count.data(), nullptr) < 0) {
+        throw std::runtime_error("could not select hyperslab");
+    }
+
+    h5_id memspace(H5Screate_simple(static_cast<int>(count.size()), count.data(), nullptr));
+
+    if (H5Dwrite(dset, memtype, memspace.get(), filespace.get(), H5P_DEFAULT, buf) < 0) {
+        throw std::runtime_error("could not write the selection");
+    }
+}
+
+void h5_read_strided(hid_t dset, hid_t memtype, size_t elsize,
+                     const std::vector<hsize_t> &start, const std::vector<hsize_t> &stride,
+                     const std::vector<hsize_t> &count, const std::vector<hsize_t> &block,
+                     void *out, const std::vector<size_t> &dst_strides)
+{
+    const size_t rank = start.size();
+    std::vector<hsize_t> shape(rank);
+    nix::NDSize extent(rank);
+    size_t nelms = 1;
+
+    for (size_t k = 0; k < rank; k++) {
+        shape[k] = count[k] * block[k];
+        extent[k] = shape[k];
+        nelms *= static_cast<size_t>(shape[k]);
+    }
+
+    if (nelms == 0) {
+        return;
+    }
+
+    h5_id filespace(H5Dget_space(dset));
+    if (H5Sselect_hyperslab(filespace.get(), H5S_SELECT_SET, start.data(), stride.data(),
+                            count.data(), block.data()) < 0) {
+        throw std::runtime_error("could not select hyperslab");
+    }
+
+    std::vector<char> buf(nelms * elsize);
+    read_selection(dset, memtype, filespace.get(), shape, buf.data());
+    transpose_copy(buf.data(), out, elsize, extent, dst_strides);
+}
@@ -0,0 +1,44 @@
+#ifndef NIX_MX_H5SELECT_H
+#define NIX_MX_H5SELECT_H
+
+#include <hdf5.h>
+
+#include <vector>
+#include <cstddef>
+
+/*
+  Reads of scattered elements with as few HDF5 selections as
+  possible. Indices are sorted and merged into regular hyperslab
+  patterns (start, stride, count, block), which HDF5 reads in one
+  go; the values are then put into the requested order.
+
+  All positions are given in file (row-major) order, the results
+  are written to `out` with the strides (in elements) given for
+  every axis of the file.
+*/
+
+//out[j0, j1, ...] = data[index[0][j0], index[1][j1], ...]
+//  the indices of every axis may be unsorted and contain repetitions
+void h5_read_indexed(hid_t dset, hid_t memtype, size_t elsize,
+                     const std::vector<std::vector<hsize_t>> &index,
+                     void *out, const std::vector<size_t> &dst_strides);
+
+//out[i] = data[coords[i * rank], ..., coords[i * rank + rank - 1]]
+void h5_read_points(hid_t dset, hid_t memtype, size_t elsize,
+                    const std::vector<hsize_t> &coords, size_t rank, void *out);
+
+//the block at offset with the given count, row-major into buf
+void h5_read_hyperslab(hid_t dset, hid_t memtype, const std::vector<hsize_t> &offset,
+                       const std::vector<hsize_t> &count, void *buf);
+
+//writes buf (row-major) to the block at offset with the given count
+void h5_write_hyperslab(hid_t dset, hid_t memtype, const std::vector<hsize_t> &offset,
+                        const std::vector<hsize_t> &count, const void *buf);
+
+//a regular hyperslab; the result has count * block elements along every axis
+void h5_read_strided(hid_t dset, hid_t memtype, size_t elsize,
+                     const std::vector<hsize_t> &start, const std::vector<hsize_t> &stride,
+                     const std::vector<hsize_t> &count, const std::vector<hsize_t> &block,
+                     void *out, const std::vector<size_t> &dst_strides);
+
+#endif
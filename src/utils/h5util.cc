@@ -0,0 +1,884 @@
+#include "h5util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+std::timed_mutex &h5_mutex()
+{
+    static std::timed_mutex mtx;
+    return mtx;
+}
+
+void h5_id::close()
+{
+    if (hid < 0) {
+        return;
+    }
+
+    switch (H5Iget_type(hid)) {
+    case H5I_FILE: H5Fclose(hid); break;
+    case H5I_GROUP: H5Gclose(hid); break;
+    case H5I_DATASET: H5Dclose(hid); break;
+    case H5I_ATTR: H5Aclose(hid); break;
+    case H5I_DATASPACE: H5Sclose(hid); break;
+    case H5I_DATATYPE: H5Tclose(hid); break;
+    case H5I_GENPROP_LST: H5Pclose(hid); break;
+    default: break;
+    }
+
+    hid = -1;
+}
+
+// *** entity lookup ***
+
+//(file name, entity id) -> path of the group within the file; ids
+// are only unique within a file, a copy of a file has the same ones
+typedef std::map<h5_entity_key, std::string> location_cache;
+static location_cache locations;
+
+//(file name, entity id) looked up by name already
+static std::set<h5_entity_key> probed;
+
+//the file of the handle the current command runs on
+static std::string scope_file;
+
+h5_file_scope::h5_file_scope(const std::string &file) : previous(scope_file)
+{
+    scope_file = file;
+}
+
+h5_file_scope::~h5_file_scope()
+{
+    scope_file = previous;
+}
+
+static herr_t collect_names(hid_t, const char *name, const H5L_info_t *, void *data)
+{
+    std::vector<std::string> *names = static_cast<std::vector<std::string> *>(data);
+    names->push_back(name);
+    return 0;
+}
+
+static std::vector<std::string> list_children(hid_t file, const std::string &path)
+{
+    std::vector<std::string> names;
+
+    htri_t exists;
+    H5E_BEGIN_TRY {
+        exists = H5Lexists(file, path.c_str(), H5P_DEFAULT);
+    } H5E_END_TRY;
+
+    if (exists > 0) {
+        H5Literate_by_name(file, path.c_str(), H5_INDEX_NAME, H5_ITER_NATIVE,
+                           nullptr, collect_names, &names, H5P_DEFAULT);
+    }
+
+    return names;
+}
+
+static std::string file_name(hid_t file)
+{
+    ssize_t len = H5Fget_name(file, nullptr, 0);
+    if (len < 0) {
+        return std::string();
+    }
+
+    std::vector<char> buf(static_cast<size_t>(len) + 1);
+    H5Fget_name(file, buf.data(), buf.size());
+    return std::string(buf.data());
+}
+
+static std::vector<hid_t> open_files()
+{
+    ssize_t n = H5Fget_obj_count(H5F_OBJ_ALL, H5F_OBJ_FILE);
+    std::vector<hid_t> ids(n > 0 ? static_cast<size_t>(n) : 0);
+
+    if (n > 0) {
+        n = H5Fget_obj_ids(H5F_OBJ_ALL, H5F_OBJ_FILE, ids.size(), ids.data());
+        ids.resize(n > 0 ? static_cast<size_t>(n) : 0);
+    }
+
+    return ids;
+}
+
+//the id of the entity stored in a group; NIX names groups either
+// after the entity name (and stores the id as attribute) or the id
+static std::string entity_id(hid_t group, const std::string &name)
+{
+    if (h5_has_attr(group, "entity_id")) {
+        return h5_read_str_attr(group, "entity_id");
+    }
+
+    return name;
+}
+
+static void scan_file(hid_t file)
+{
+    const std::string fname = file_name(file);
+
+    for (const std::string &block : list_children(file, "/data")) {
+        const std::string base = "/data/" + block + "/data_arrays";
+
+        for (const std::string &name : list_children(file, base)) {
+            const std::string path = base + "/" + name;
+
+            h5_id group(H5Gopen2(file, path.c_str(), H5P_DEFAULT));
+            if (group.valid()) {
+                locations[h5_entity_key(fname, entity_id(group.get(), name))] = path;
+            }
+        }
+    }
+}
+
+//the group of the entity in the file named file, or in any open file
+// if that is empty; throws if it is in more than one of them then
+static h5_id open_cached(const std::string &id, const std::string &file)
+{
+    h5_id found;
+    std::string found_in;
+
+    for (hid_t f : open_files()) {
+        const std::string fname = file_name(f);
+        if (!file.empty() && fname != file) {
+            continue;
+        }
+
+        location_cache::const_iterator it = locations.find(h5_entity_key(fname, id));
+        if (it == locations.end() || (found.valid() && fname == found_in)) {
+            continue;
+        }
+
+        h5_id group;
+        H5E_BEGIN_TRY {
+            group = h5_id(H5Gopen2(f, it->second.c_str(), H5P_DEFAULT));
+        } H5E_END_TRY;
+
+        //the group might have been deleted and replaced in the meantime
+        if (!group.valid() || entity_id(group.get(), "") != id) {
+            continue;
+        }
+
+        if (found.valid()) {
+            throw std::runtime_error("DataArray " + id + " is in more than one open file (" +
+                                     found_in + ", " + fname + ")");
+        }
+
+        found = std::move(group);
+        found_in = fname;
+    }
+
+    return found;
+}
+
+//cheap guess for entities missing from the cache (e.g. new ones):
+// look for a group named after the entity in every block
+static void probe_name(hid_t file, const std::string &id, const std::string &name)
+{
+    for (const std::string &block : list_children(file, "/data")) {
+        const std::string path = "/data/" + block + "/data_arrays/" + name;
+
+        h5_id group;
+        H5E_BEGIN_TRY {
+            group = h5_id(H5Gopen2(file, path.c_str(), H5P_DEFAULT));
+        } H5E_END_TRY;
+
+        if (group.valid() && entity_id(group.get(), name) == id) {
+            locations[h5_entity_key(file_name(file), id)] = path;
+            return;
+        }
+    }
+}
+
+h5_id h5_open_group(const nix::DataArray &da, const std::string &file)
+{
+    const std::string id = da.id();
+
+    //every open file is asked once, so that an entity in two files
+    // is noticed even if one of them has been cached already
+    for (hid_t f : open_files()) {
+        const h5_entity_key key(file_name(f), id);
+        if (!file.empty() && key.first != file) {
+            continue;
+        }
+        if (locations.count(key) == 0 && probed.insert(key).second) {
+            probe_name(f, id, da.name());
+        }
+    }
+
+    h5_id group = open_cached(id, file);
+    if (group.valid()) {
+        return group;
+    }
+
+    locations.clear();
+    probed.clear();
+    for (hid_t f : open_files()) {
+        scan_file(f);
+    }
+
+    group = open_cached(id, file);
+
+    //not in the file it was expected in, e.g. one opened under
+    // another name; fine as long as no other file has it
+    if (!group.valid() && !file.empty()) {
+        group = open_cached(id, std::string());
+    }
+
+    if (!group.valid()) {
+        throw std::runtime_error("could not locate the HDF5 group of DataArray " + id);
+    }
+
+    return group;
+}
+
+h5_id h5_open_group(const nix::DataArray &da)
+{
+    return h5_open_group(da, scope_file);
+}
+
+h5_id h5_open_data(const nix::DataArray &da)
+{
+    h5_id group = h5_open_group(da);
+    h5_id data(H5Dopen2(group.get(), "data", H5P_DEFAULT));
+
+    if (!data.valid()) {
+        throw std::runtime_error("could not open the data of DataArray " + da.id());
+    }
+
+    return data;
+}
+
+h5_id h5_file_of(const nix::DataArray &da)
+{
+    h5_id group = h5_open_group(da);
+    return h5_id(H5Iget_file_id(group.get()));
+}
+
+h5_entity_key h5_key_of(const nix::DataArray &da)
+{
+    h5_id file = h5_file_of(da);
+    return h5_entity_key(file_name(file.get()), da.id());
+}
+
+std::string h5_path_of(hid_t obj)
+{
+    ssize_t len = H5Iget_name(obj, nullptr, 0);
+    if (len <= 0) {
+        throw std::runtime_error("could not query the path of an object");
+    }
+
+    std::vector<char> buf(static_cast<size_t>(len) + 1);
+    H5Iget_name(obj, buf.data(), buf.size());
+    return std::string(buf.data());
+}
+
+// *** file access ***
+
+h5_id h5_make_fapl(const h5_access &access)
+{
+    h5_id fapl(H5Pcreate(H5P_FILE_ACCESS));
+
+    if (access.chunk_cache_bytes > 0 || access.chunk_cache_slots > 0 || access.chunk_cache_policy >= 0) {
+        int mdc_nelmts;
+        size_t slots, bytes;
+        double w0;
+        H5Pget_cache(fapl.get(), &mdc_nelmts, &slots, &bytes, &w0);
+
+        if (access.chunk_cache_policy > 1) {
+            throw std::invalid_argument("the chunk cache policy must be in 0..1");
+        }
+
+        //few slots make chunks evict each other; HDF5 advises about
+        // 100 times the number of chunks that fit, assume 1 MB chunks
+        if (access.chunk_cache_slots > 0) {
+            slots = access.chunk_cache_slots;
+        } else if (access.chunk_cache_bytes > bytes) {
+            slots = std::max(slots, access.chunk_cache_bytes / 10000) | 1;
+        }
+
+        if (access.chunk_cache_bytes > 0) {
+            bytes = access.chunk_cache_bytes;
+        }
+
+        if (access.chunk_cache_policy >= 0) {
+            w0 = access.chunk_cache_policy;
+        }
+
+        H5Pset_cache(fapl.get(), mdc_nelmts, slots, bytes, w0);
+    }
+
+    if (access.metadata_cache_bytes > 0) {
+        H5AC_cache_config_t config;
+        config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+        H5Pget_mdc_config(fapl.get(), &config);
+
+        config.set_initial_size = true;
+        config.initial_size = access.metadata_cache_bytes;
+        config.max_size = access.metadata_cache_bytes;
+        config.min_size = std::min(config.min_size, access.metadata_cache_bytes);
+
+        if (access.keep_metadata) {
+            config.min_size = access.metadata_cache_bytes;
+            config.decr_mode = H5C_decr__off;
+        }
+
+        if (H5Pset_mdc_config(fapl.get(), &config) < 0) {
+            throw std::invalid_argument("invalid metadata cache size");
+        }
+    }
+
+    if (access.sieve_buffer_bytes > 0) {
+        H5Pset_sieve_buf_size(fapl.get(), access.sieve_buffer_bytes);
+    }
+
+    if (access.meta_block_bytes > 0) {
+        H5Pset_meta_block_size(fapl.get(), access.meta_block_bytes);
+    }
+
+    if (access.latest_format) {
+        H5Pset_libver_bounds(fapl.get(), H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    }
+
+    if (access.page_buffer_bytes > 0) {
+#if H5_VERSION_GE(1, 10, 1)
+        if (H5Pset_page_buffer_size(fapl.get(), access.page_buffer_bytes, 0, 0) < 0) {
+            throw std::invalid_argument("invalid page buffer size");
+        }
+#else
+        throw std::invalid_argument("page buffers require HDF5 1.10.1");
+#endif
+    }
+
+    return fapl;
+}
+
+static herr_t copy_attr(hid_t src, const char *name, const H5A_info_t *info, void *dst);
+
+static herr_t copy_link(hid_t src, const char *name, const H5L_info_t *, void *dst)
+{
+    return H5Ocopy(src, name, *static_cast<hid_t *>(dst), name, H5P_DEFAULT, H5P_DEFAULT);
+}
+
+void h5_recreate_file(const std::string &name, const h5_creation &creation, hid_t fapl)
+{
+    h5_id src(H5Fopen(name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT));
+    if (!src.valid()) {
+        throw std::runtime_error("could not open file " + name);
+    }
+
+    //keeps what NIX has set up for its files, e.g. link order tracking
+    // of the root group, which is not part of the file creation list
+    h5_id fcpl(H5Fget_create_plist(src.get()));
+    {
+        h5_id root(H5Gopen2(src.get(), "/", H5P_DEFAULT));
+        h5_id gcpl(H5Gget_create_plist(root.get()));
+        unsigned int order = 0;
+        H5Pget_link_creation_order(gcpl.get(), &order);
+        H5Pset_link_creation_order(fcpl.get(), order);
+    }
+
+    if (creation.page_size > 0) {
+#if H5_VERSION_GE(1, 10, 1)
+        if (H5Pset_file_space_strategy(fcpl.get(), H5F_FSPACE_STRATEGY_PAGE, 0, 1) < 0 ||
+            H5Pset_file_space_page_size(fcpl.get(), creation.page_size) < 0) {
+            throw std::invalid_argument("invalid file space page size");
+        }
+#else
+        throw std::invalid_argument("paged file space requires HDF5 1.10.1");
+#endif
+    }
+
+    const std::string tmp_name = name + ".layout";
+    {
+        h5_id dst(H5Fcreate(tmp_name.c_str(), H5F_ACC_TRUNC, fcpl.get(), fapl));
+        if (!dst.valid()) {
+            throw std::runtime_error("could not create file " + tmp_name);
+        }
+
+        h5_id src_root(H5Gopen2(src.get(), "/", H5P_DEFAULT));
+        h5_id dst_root(H5Gopen2(dst.get(), "/", H5P_DEFAULT));
+        hid_t dst_id = dst_root.get();
+
+        if (H5Aiterate2(src_root.get(), H5_INDEX_NAME, H5_ITER_NATIVE, nullptr, copy_attr, &dst_id) < 0 ||
+            H5Literate(src_root.get(), H5_INDEX_NAME, H5_ITER_NATIVE, nullptr, copy_link, &dst_id) < 0) {
+            dst_root.close();
+            dst.close();
+            std::remove(tmp_name.c_str());
+            throw std::runtime_error("could not copy file " + name);
+        }
+    }
+
+    src.close();
+
+    //rename does not replace files on every platform
+    if (std::remove(name.c_str()) != 0 || std::rename(tmp_name.c_str(), name.c_str()) != 0) {
+        throw std::runtime_error("could not replace file " + name);
+    }
+}
+
+unsigned int h5_open_flags(bool writable, bool swmr)
+{
+    unsigned int flags = writable ? H5F_ACC_RDWR : H5F_ACC_RDONLY;
+
+    if (swmr) {
+#ifdef H5F_ACC_SWMR_READ
+        flags |= writable ? H5F_ACC_SWMR_WRITE : H5F_ACC_SWMR_READ;
+#else
+        throw std::invalid_argument("SWMR access requires HDF5 1.10");
+#endif
+    }
+
+    return flags;
+}
+
+h5_id h5_pin_file(const std::string &name, unsigned int flags, hid_t fapl)
+{
+    h5_id file(H5Fopen(name.c_str(), flags, fapl));
+
+    if (!file.valid()) {
+        throw std::runtime_error("could not open file " + name);
+    }
+
+    return file;
+}
+
+size_t h5_preload_file(const std::string &name)
+{
+    std::ifstream in(name.c_str(), std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("could not read file " + name);
+    }
+
+    std::vector<char> buf(4 << 20);
+    size_t total = 0;
+
+    while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
+        total += static_cast<size_t>(in.gcount());
+    }
+
+    return total;
+}
+
+std::string h5_file_name(hid_t file)
+{
+    return file_name(file);
+}
+
+void h5_flush_file(hid_t obj)
+{
+    const std::string name = file_name(obj);
+    bool ok = !name.empty();
+
+    for (hid_t file : open_files()) {
+        if (ok && file_name(file) == name) {
+            ok = H5Fflush(file, H5F_SCOPE_LOCAL) >= 0;
+        }
+    }
+
+    if (!ok) {
+        throw std::runtime_error("could not flush file " + name);
+    }
+}
+
+bool h5_is_swmr(hid_t file)
+{
+#ifdef H5F_ACC_SWMR_READ
+    unsigned int intent = 0;
+    return H5Fget_intent(file, &intent) >= 0 &&
+        (intent & (H5F_ACC_SWMR_READ | H5F_ACC_SWMR_WRITE)) != 0;
+#else
+    return false;
+#endif
+}
+
+h5_id h5_find_file(const std::string &name)
+{
+    for (hid_t file : open_files()) {
+        if (file_name(file) == name) {
+            //the id belongs to someone else, the result must not close it
+            return h5_id(H5Freopen(file));
+        }
+    }
+
+    throw std::runtime_error("file " + name + " is not open");
+}
+
+h5_access h5_get_access(hid_t file)
+{
+    h5_access access;
+    h5_id fapl(H5Fget_access_plist(file));
+
+    int mdc_nelmts;
+    H5Pget_cache(fapl.get(), &mdc_nelmts, &access.chunk_cache_slots,
+                 &access.chunk_cache_bytes, &access.chunk_cache_policy);
+    H5Pget_sieve_buf_size(fapl.get(), &access.sieve_buffer_bytes);
+
+    H5AC_cache_config_t config;
+    config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+    if (H5Fget_mdc_config(file, &config) >= 0) {
+        access.metadata_cache_bytes = config.max_size;
+    }
+
+    hsize_t meta_block = 0;
+    H5Pget_meta_block_size(fapl.get(), &meta_block);
+    access.meta_block_bytes = static_cast<size_t>(meta_block);
+
+    H5F_libver_t low, high;
+    H5Pget_libver_bounds(fapl.get(), &low, &high);
+    access.latest_format = low == H5F_LIBVER_LATEST;
+
+#if H5_VERSION_GE(1, 10, 1)
+    unsigned int min_meta, min_raw;
+    H5Pget_page_buffer_size(fapl.get(), &access.page_buffer_bytes, &min_meta, &min_raw);
+#endif
+
+    return access;
+}
+
+h5_creation h5_get_creation(hid_t file)
+{
+    h5_creation creation;
+
+#if H5_VERSION_GE(1, 10, 1)
+    h5_id fcpl(H5Fget_create_plist(file));
+    H5F_fspace_strategy_t strategy;
+    hbool_t persist;
+    hsize_t threshold, page_size;
+
+    H5Pget_file_space_strategy(fcpl.get(), &strategy, &persist, &threshold);
+    if (strategy == H5F_FSPACE_STRATEGY_PAGE) {
+        H5Pget_file_space_page_size(fcpl.get(), &page_size);
+        creation.page_size = static_cast<size_t>(page_size);
+    }
+#endif
+
+    return creation;
+}
+
+#ifdef H5F_ACC_SWMR_READ
+static herr_t refresh_object(hid_t group, const char *name, const H5O_info_t *info, void *)
+{
+    if (info->type == H5O_TYPE_GROUP || info->type == H5O_TYPE_DATASET) {
+        h5_id obj(H5Oopen(group, name, H5P_DEFAULT));
+        if (H5Orefresh(obj.get()) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+#endif
+
+void h5_refresh(const nix::DataArray &da)
+{
+#ifdef H5F_ACC_SWMR_READ
+    h5_id group = h5_open_group(da);
+
+    //visits the group itself as "."
+    if (H5Ovisit(group.get(), H5_INDEX_NAME, H5_ITER_NATIVE, refresh_object, nullptr) < 0) {
+        throw std::runtime_error("could not refresh DataArray " + da.id());
+    }
+#endif
+}
+
+// *** layout ***
+
+nix::NDSize h5_chunk_extent(hid_t dset)
+{
+    h5_id dcpl(H5Dget_create_plist(dset));
+
+    if (!dcpl.valid() || H5Pget_layout(dcpl.get()) != H5D_CHUNKED) {
+        return nix::NDSize();
+    }
+
+    const int rank = H5Pget_chunk(dcpl.get(), 0, nullptr);
+    if (rank < 0) {
+        throw std::runtime_error("could not query the chunk extent");
+    }
+
+    std::vector<hsize_t> dims(static_cast<size_t>(rank));
+    H5Pget_chunk(dcpl.get(), rank, dims.data());
+
+    nix::NDSize extent(dims.size());
+    std::copy(dims.begin(), dims.end(), extent.begin());
+    return extent;
+}
+
+h5_layout h5_get_layout(hid_t dset)
+{
+    h5_layout layout;
+    layout.chunks = h5_chunk_extent(dset);
+    layout.contiguous = layout.chunks.size() == 0;
+
+    h5_id dcpl(H5Dget_create_plist(dset));
+    if (!dcpl.valid()) {
+        throw std::runtime_error("could not query the dataset layout");
+    }
+
+    const int nfilters = H5Pget_nfilters(dcpl.get());
+    for (int i = 0; i < nfilters; i++) {
+        unsigned int flags = 0;
+        unsigned int values[8] = { 0 };
+        size_t nvalues = 8;
+        char name[64];
+
+        H5Z_filter_t filter = H5Pget_filter2(dcpl.get(), static_cast<unsigned>(i), &flags,
+                                             &nvalues, values, sizeof(name), name, nullptr);
+        if (filter == H5Z_FILTER_DEFLATE) {
+            layout.deflate = nvalues > 0 ? static_cast<int>(values[0]) : 0;
+        } else if (filter == H5Z_FILTER_SHUFFLE) {
+            layout.shuffle = true;
+        }
+    }
+
+    //types without a conversion to double (booleans) report 0
+    double fill = 0;
+    H5E_BEGIN_TRY {
+        if (H5Pget_fill_value(dcpl.get(), H5T_NATIVE_DOUBLE, &fill) >= 0) {
+            layout.fill = fill;
+        }
+    } H5E_END_TRY;
+
+    return layout;
+}
+
+bool h5_simple_filters(hid_t dset, std::vector<h5_filter> &filters)
+{
+    h5_id dcpl(H5Dget_create_plist(dset));
+    if (!dcpl.valid()) {
+        throw std::runtime_error("could not query the dataset layout");
+    }
+
+    const int nfilters = H5Pget_nfilters(dcpl.get());
+    for (int i = 0; i < nfilters; i++) {
+        unsigned int flags = 0;
+        unsigned int values[8] = { 0 };
+        size_t nvalues = 8;
+        char name[64];
+
+        H5Z_filter_t filter = H5Pget_filter2(dcpl.get(), static_cast<unsigned>(i), &flags,
+                                             &nvalues, values, sizeof(name), name, nullptr);
+        if (filter != H5Z_FILTER_DEFLATE && filter != H5Z_FILTER_SHUFFLE) {
+            return false;
+        }
+
+        h5_filter f { filter, nvalues > 0 ? values[0] : 0 };
+        filters.push_back(f);
+    }
+
+    return true;
+}
+
+bool h5_decodable_chunks(hid_t dset, hid_t memtype)
+{
+#if H5_VERSION_GE(1, 10, 2)
+    if (h5_chunk_extent(dset).size() == 0) {
+        return false;
+    }
+
+    std::vector<h5_filter> filters;
+    if (!h5_simple_filters(dset, filters)) {
+        return false;
+    }
+
+    h5_id ftype(H5Dget_type(dset));
+    return H5Tequal(ftype.get(), memtype) > 0;
+#else
+    return false;
+#endif
+}
+
+bool h5_direct_chunks(hid_t dset, hid_t memtype)
+{
+    //without filters HDF5 moves chunks straight into place
+    std::vector<h5_filter> filters;
+    return h5_decodable_chunks(dset, memtype) && h5_simple_filters(dset, filters) && !filters.empty();
+}
+
+//copies the attributes of one object to another
+static herr_t copy_attr(hid_t src, const char *name, const H5A_info_t *info, void *dst)
+{
+    h5_id attr(H5Aopen(src, name, H5P_DEFAULT));
+    h5_id type(H5Aget_type(attr.get()));
+    h5_id space(H5Aget_space(attr.get()));
+
+    const hssize_t npoints = H5Sget_simple_extent_npoints(space.get());
+    std::vector<char> buf(H5Tget_size(type.get()) * static_cast<size_t>(std::max<hssize_t>(npoints, 1)));
+
+    if (H5Aread(attr.get(), type.get(), buf.data()) < 0) {
+        return -1;
+    }
+
+    h5_id copy(H5Acreate2(*static_cast<hid_t *>(dst), name, type.get(), space.get(),
+                          H5P_DEFAULT, H5P_DEFAULT));
+    const herr_t res = H5Awrite(copy.get(), type.get(), buf.data());
+
+    if (H5Tdetect_class(type.get(), H5T_VLEN) > 0 || H5Tis_variable_str(type.get()) > 0) {
+        H5Dvlen_reclaim(type.get(), space.get(), H5P_DEFAULT, buf.data());
+    }
+
+    return res;
+}
+
+void h5_set_layout(const nix::DataArray &da, const h5_layout &layout)
+{
+    h5_id group = h5_open_group(da);
+    h5_id old = h5_open_data(da);
+
+    h5_id ftype(H5Dget_type(old.get()));
+    h5_id fspace(H5Dget_space(old.get()));
+
+    const int rank = H5Sget_simple_extent_ndims(fspace.get());
+    if (rank <= 0) {
+        throw std::invalid_argument("scalar data cannot be chunked");
+    }
+
+    std::vector<hsize_t> dims(static_cast<size_t>(rank));
+    H5Sget_simple_extent_dims(fspace.get(), dims.data(), nullptr);
+    std::vector<hsize_t> maxdims(dims.size(), H5S_UNLIMITED);
+
+    h5_id dcpl(H5Pcreate(H5P_DATASET_CREATE));
+
+    if (layout.contiguous) {
+        if (layout.chunks.size() > 0 || layout.deflate > 0 || layout.shuffle) {
+            throw std::invalid_argument("contiguous data cannot be chunked or compressed");
+        }
+
+        H5Pset_layout(dcpl.get(), H5D_CONTIGUOUS);
+        maxdims = dims;
+    } else {
+        nix::NDSize chunks = layout.chunks.size() > 0 ? layout.chunks : h5_chunk_extent(old.get());
+        if (chunks.size() != dims.size()) {
+            throw std::invalid_argument("chunks must have one entry per dimension");
+        }
+
+        std::vector<hsize_t> chunk_dims(chunks.begin(), chunks.end());
+        if (std::find(chunk_dims.begin(), chunk_dims.end(), 0) != chunk_dims.end()) {
+            throw std::invalid_argument("chunks must not be empty");
+        }
+
+        H5Pset_chunk(dcpl.get(), rank, chunk_dims.data());
+
+        if (layout.shuffle) {
+            H5Pset_shuffle(dcpl.get());
+        }
+
+        if (layout.deflate > 0) {
+            if (layout.deflate > 9 || H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+                throw std::invalid_argument("deflate level must be in 0..9 and deflate available");
+            }
+            H5Pset_deflate(dcpl.get(), static_cast<unsigned>(layout.deflate));
+        }
+    }
+
+    if (layout.fill != 0 && H5Pset_fill_value(dcpl.get(), H5T_NATIVE_DOUBLE, &layout.fill) < 0) {
+        throw std::invalid_argument("fill values require a numeric data type");
+    }
+
+    //the new dataset is complete before the old one goes away
+    static const char *tmp_name = "data.layout";
+    h5_id space(H5Screate_simple(rank, dims.data(), maxdims.data()));
+    h5_id dset(H5Dcreate2(group.get(), tmp_name, ftype.get(), space.get(),
+                          H5P_DEFAULT, dcpl.get(), H5P_DEFAULT));
+
+    if (!dset.valid()) {
+        throw std::runtime_error("could not create the dataset of DataArray " + da.id());
+    }
+
+    hid_t dst = dset.get();
+    H5Aiterate2(old.get(), H5_INDEX_NAME, H5_ITER_NATIVE, nullptr, copy_attr, &dst);
+
+    old.close();
+    dset.close();
+
+    if (H5Ldelete(group.get(), "data", H5P_DEFAULT) < 0 ||
+        H5Lmove(group.get(), tmp_name, group.get(), "data", H5P_DEFAULT, H5P_DEFAULT) < 0) {
+        throw std::runtime_error("could not replace the dataset of DataArray " + da.id());
+    }
+}
+
+h5_id h5_mem_type(hid_t dset, nix::DataType dtype)
+{
+    hid_t native;
+
+    switch (dtype) {
+    case nix::DataType::Bool: return h5_id(H5Dget_type(dset));
+    case nix::DataType::Float: native = H5T_NATIVE_FLOAT; break;
+    case nix::DataType::Double: native = H5T_NATIVE_DOUBLE; break;
+    case nix::DataType::Int8: native = H5T_NATIVE_INT8; break;
+    case nix::DataType::Int16: native = H5T_NATIVE_INT16; break;
+    case nix::DataType::Int32: native = H5T_NATIVE_INT32; break;
+    case nix::DataType::Int64: native = H5T_NATIVE_INT64; break;
+    case nix::DataType::UInt8: native = H5T_NATIVE_UINT8; break;
+    case nix::DataType::UInt16: native = H5T_NATIVE_UINT16; break;
+    case nix::DataType::UInt32: native = H5T_NATIVE_UINT32; break;
+    case nix::DataType::UInt64: native = H5T_NATIVE_UINT64; break;
+    default: throw std::domain_error("Unsupported data type");
+    }
+
+    return h5_id(H5Tcopy(native));
+}
+
+// *** attributes ***
+
+bool h5_has_attr(hid_t obj, const std::string &name)
+{
+    return H5Aexists(obj, name.c_str()) > 0;
+}
+
+std::string h5_read_str_attr(hid_t obj, const std::string &name)
+{
+    h5_id attr(H5Aopen(obj, name.c_str(), H5P_DEFAULT));
+    h5_id ftype(H5Aget_type(attr.get()));
+
+    if (!attr.valid() || H5Tget_class(ftype.get()) != H5T_STRING) {
+        throw std::runtime_error("attribute " + name + " is not a string");
+    }
+
+    std::string res;
+
+    if (H5Tis_variable_str(ftype.get()) > 0) {
+        h5_id mtype(H5Tcopy(H5T_C_S1));
+        H5Tset_size(mtype.get(), H5T_VARIABLE);
+
+        char *str = nullptr;
+        H5Aread(attr.get(), mtype.get(), &str);
+        if (str != nullptr) {
+            res = str;
+            H5free_memory(str);
+        }
+    } else {
+        const size_t len = H5Tget_size(ftype.get());
+        h5_id mtype(H5Tcopy(H5T_C_S1));
+        H5Tset_size(mtype.get(), len + 1);
+
+        std::vector<char> buf(len + 1, '\0');
+        H5Aread(attr.get(), mtype.get(), buf.data());
+        res = buf.data();
+    }
+
+    return res;
+}
+
+void h5_write_str_attr(hid_t obj, const std::string &name, const std::string &value)
+{
+    if (h5_has_attr(obj, name)) {
+        H5Adelete(obj, name.c_str());
+    }
+
+    h5_id dtype(H5Tcopy(H5T_C_S1));
+    H5Tset_size(dtype.get(), H5T_VARIABLE);
+    h5_id space(H5Screate(H5S_SCALAR));
+
+    h5_id attr(H5Acreate2(obj, name.c_str(), dtype.get(), space.get(), H5P_DEFAULT, H5P_DEFAULT));
+    const char *str = value.c_str();
+
+    if (!attr.valid() || H5Awrite(attr.get(), dtype.get(), &str) < 0) {
+        throw std::runtime_error("could not write attribute " + name);
+    }
+}
@@ -0,0 +1,248 @@
+#ifndef NIX_MX_H5UTIL_H
+#define NIX_MX_H5UTIL_H
+
+#include <hdf5.h>
+#include <nix.hpp>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+  NIX does not expose the HDF5 objects behind its entities, but
+  the files it opens are visible to every HDF5 user in the process.
+  The helpers below look up the group of a DataArray by its id,
+  so that things NIX has no API for (attributes, layout, ...) can
+  be done on the HDF5 level.
+*/
+
+// *** threads ***
+
+//HDF5 is not thread-safe; every command holds this lock while it
+//  runs, so threads of our own must take it around their HDF5 calls
+std::timed_mutex &h5_mutex();
+
+//runs wait() with h5_mutex released, e.g. to let a worker finish;
+//  the calling thread must hold the lock
+template<typename F>
+void h5_unlocked(F &&wait)
+{
+    h5_mutex().unlock();
+
+    try {
+        wait();
+    } catch (...) {
+        h5_mutex().lock();
+        throw;
+    }
+
+    h5_mutex().lock();
+}
+
+// *** owning wrapper for HDF5 identifiers ***
+
+class h5_id {
+public:
+    explicit h5_id(hid_t id = -1) : hid(id) { }
+
+    h5_id(const h5_id &other) = delete;
+    h5_id &operator=(const h5_id &other) = delete;
+
+    h5_id(h5_id &&other) : hid(other.hid) {
+        other.hid = -1;
+    }
+
+    h5_id &operator=(h5_id &&other) {
+        if (this != &other) {
+            close();
+            hid = other.hid;
+            other.hid = -1;
+        }
+        return *this;
+    }
+
+    ~h5_id() {
+        close();
+    }
+
+    hid_t get() const {
+        return hid;
+    }
+
+    bool valid() const {
+        return hid >= 0;
+    }
+
+    void close();
+
+private:
+    hid_t hid;
+};
+
+// *** entity lookup ***
+
+//(file name, entity id); ids are only unique within a file
+typedef std::pair<std::string, std::string> h5_entity_key;
+
+//the file h5_open_group looks DataArrays up in while the scope
+//  exists, that of the handle a command runs on; empty for any file
+class h5_file_scope {
+public:
+    explicit h5_file_scope(const std::string &file);
+    ~h5_file_scope();
+
+    h5_file_scope(const h5_file_scope &) = delete;
+    h5_file_scope &operator=(const h5_file_scope &) = delete;
+
+private:
+    std::string previous;
+};
+
+//the group of the DataArray in the file named file, or in one of the
+//  open files if file is empty; throws if not found or if more than
+//  one open file has an entity with its id and file does not decide
+h5_id h5_open_group(const nix::DataArray &da, const std::string &file);
+
+//the group of the DataArray in the file of the current h5_file_scope
+h5_id h5_open_group(const nix::DataArray &da);
+
+//the dataset holding the data of the DataArray
+h5_id h5_open_data(const nix::DataArray &da);
+
+//the file the DataArray lives in
+h5_id h5_file_of(const nix::DataArray &da);
+
+//the name of the file the DataArray lives in and its id
+h5_entity_key h5_key_of(const nix::DataArray &da);
+
+//path of an object within its file
+std::string h5_path_of(hid_t obj);
+
+// *** file access ***
+
+//access properties of a file, zero keeps the HDF5 default
+struct h5_access {
+    size_t chunk_cache_bytes;
+    size_t chunk_cache_slots;
+    double chunk_cache_policy; //preemption of fully read chunks, w0 in 0..1
+    size_t metadata_cache_bytes;
+    size_t sieve_buffer_bytes;
+    bool keep_metadata;       //never shrink the metadata cache
+    size_t page_buffer_bytes; //paged files only
+    size_t meta_block_bytes;  //metadata is allocated in blocks of this size
+    bool latest_format;       //new objects use the latest file format
+
+    h5_access() : chunk_cache_bytes(0), chunk_cache_slots(0), chunk_cache_policy(-1),
+        metadata_cache_bytes(0), sieve_buffer_bytes(0), keep_metadata(false),
+        page_buffer_bytes(0), meta_block_bytes(0), latest_format(false) { }
+};
+
+//file space layout of new files
+struct h5_creation {
+    size_t page_size; //paged allocation with pages of this size, 0 for none
+
+    h5_creation() : page_size(0) { }
+};
+
+h5_id h5_make_fapl(const h5_access &access);
+
+//opens the file with the given access list. HDF5 shares one file
+//  object among all opens of the same file, so NIX opening it while
+//  this stays open gets the caches and buffers set up here
+h5_id h5_pin_file(const std::string &name, unsigned int flags, hid_t fapl);
+
+//H5F_ACC_* flags for opening a file; swmr reading and writing
+//  require HDF5 1.10
+unsigned int h5_open_flags(bool writable, bool swmr);
+
+//reloads the metadata of the DataArray (group, data, dimensions)
+//  from the file, e.g. to see what a SWMR writer has appended
+void h5_refresh(const nix::DataArray &da);
+
+h5_creation h5_get_creation(hid_t file);
+
+//rewrites a file that has just been created (by NIX) with the given
+//  layout: its content is copied into a new file that is then moved
+//  in place, so it must not be open
+void h5_recreate_file(const std::string &name, const h5_creation &creation, hid_t fapl);
+
+//largest metadata cache HDF5 accepts
+const size_t h5_max_metadata_cache = 128 << 20;
+
+//reads the whole file once, so that the operating system has it in
+//  memory for the small reads that follow; returns its size
+size_t h5_preload_file(const std::string &name);
+
+//the name the file has been opened with
+std::string h5_file_name(hid_t file);
+
+//flushes the file obj belongs to through all of its open ids; a
+//  flush through one id misses the datasets opened through others
+void h5_flush_file(hid_t obj);
+
+//true if the file has been opened for SWMR reading or writing
+bool h5_is_swmr(hid_t file);
+
+//the file of that name among the open ones, throws if there is none
+h5_id h5_find_file(const std::string &name);
+
+//the access properties in effect for an open file
+h5_access h5_get_access(hid_t file);
+
+// *** layout ***
+
+//chunk extent of the dataset, empty if it is not chunked
+nix::NDSize h5_chunk_extent(hid_t dset);
+
+//storage of a dataset; chunks are in file order, empty if contiguous
+struct h5_layout {
+    nix::NDSize chunks;
+    int deflate;  //compression level, 0 without compression
+    bool shuffle;
+    double fill;
+    bool contiguous;  //a fixed extent without chunks and filters
+
+    h5_layout() : deflate(0), shuffle(false), fill(0), contiguous(false) { }
+};
+
+h5_layout h5_get_layout(hid_t dset);
+
+//a filter of the pipeline, level is that of deflate
+struct h5_filter {
+    H5Z_filter_t id;
+    unsigned int level;
+};
+
+//the filters of a dataset in the order they are applied on writes;
+//  false if there are others than deflate and shuffle
+bool h5_simple_filters(hid_t dset, std::vector<h5_filter> &filters);
+
+//true if chunks of the dataset can be read as stored (HDF5 1.10.2)
+//  and decoded by nix-mx: the dataset is chunked, has simple filters
+//  only, if any, and memtype needs no conversion
+bool h5_decodable_chunks(hid_t dset, hid_t memtype);
+
+//true if chunks of the dataset can be read and written as stored
+//  and filtered by nix-mx: they are decodable and compressed
+bool h5_direct_chunks(hid_t dset, hid_t memtype);
+
+//replaces the dataset of a DataArray that holds no data yet by an
+//  empty one of the same type and extent but the given layout;
+//  chunks default to those of the current dataset, contiguous
+//  datasets cannot be resized
+void h5_set_layout(const nix::DataArray &da, const h5_layout &layout);
+
+//in-memory type for reading the dataset as dtype; booleans are
+//  stored as an enum and read without conversion
+h5_id h5_mem_type(hid_t dset, nix::DataType dtype);
+
+// *** attributes ***
+
+bool h5_has_attr(hid_t obj, const std::string &name);
+
+std::string h5_read_str_attr(hid_t obj, const std::string &name);
+
+void h5_write_str_attr(hid_t obj, const std::string &name, const std::string &value);
+
+#endif
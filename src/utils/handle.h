@@ -10,6 +10,8 @@
 #include <mex.h>
 #include <nix.hpp>
 
+#include <string>
+
 // *** nix entities holder ***
 
 template<typename T>
@@ -92,6 +94,14 @@ struct entity_to_id<nix::RangeDimension> {
     static const int value = 103;
 };
 
+class data_cursor; // see cursor.h
+
+template<>
+struct entity_to_id<data_cursor> {
+    static const bool is_valid = true;
+    static const int value = 104;
+};
+
 
 class handle {
 public:
@@ -102,6 +112,9 @@ public:
 
         int id;
 
+        //the file the entity was read from
+        std::string file;
+
         virtual void destory() = 0;
 
         virtual time_t updated_at() const = 0;
@@ -122,6 +135,7 @@ public:
         //we don't get unloaded before we have
         //destructed/destroyed all the entities
         mexLock();
+        et->file = file_of(obj);
     }
 
     explicit handle(uint64_t h) : et(reinterpret_cast<entity *>(h)) { }
@@ -153,7 +167,27 @@ public:
         return et;
     }
 
+    const std::string &file() const {
+        return et->file;
+    }
+
+    //the file of the handle the current command runs on; entities
+    // the command returns come from the same file
+    static std::string &current_file() {
+        static std::string file;
+        return file;
+    }
+
 private:
+    static std::string file_of(const nix::File &fd) {
+        return fd.location();
+    }
+
+    template<typename T>
+    static std::string file_of(const T &) {
+        return current_file();
+    }
+
     template<typename T, typename Enable = void>
     struct cell : public entity {
         cell(const T &obj) : entity(obj), obj(obj) { }
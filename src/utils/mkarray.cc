@@ -1,20 +1,142 @@
 #include "mkarray.h"
+#include "transpose.h"
 #include "mex.h"
 #include <nix.hpp>
 
-mxArray* make_mx_array_from_ds(const nix::DataSet &da) {
-    nix::NDSize size = da.dataExtent();
-    const size_t len = size.size();
-    std::vector<mwSize> dims(len);
+#include <algorithm>
+
+//upper bound for the scratch buffer used to transpose the data
+static const size_t read_block_bytes = 1 << 24;
+
+//the scratch buffer is kept between reads, so repeated reads of
+// the same shape do not allocate
+static char *scratch_buffer(size_t nbytes) {
+    static thread_local std::vector<char> buf;
+
+    if (buf.size() < nbytes) {
+        buf.resize(nbytes);
+    }
+
+    return buf.data();
+}
+
+mxArray* make_mx_array_uninitialized(const nix::NDSize &extent, DType2 dtype) {
+    std::vector<mwSize> dims;
+
+    //matlab arrays have at least two dimensions, 1-d data is a row vector
+    if (extent.size() < 2) {
+        dims.push_back(1);
+    }
+
+    for (size_t i = 0; i < extent.size(); i++) {
+        dims.push_back(static_cast<mwSize>(extent[i]));
+    }
+
+    if (dims.size() < 2) {
+        dims.push_back(1);
+    }
+
+    mxArray *data;
+    if (dtype.cid == mxLOGICAL_CLASS) {
+        data = mxCreateLogicalMatrix(0, 0);
+    } else {
+        data = mxCreateNumericMatrix(0, 0, dtype.cid, dtype.clx);
+    }
+
+    const size_t nelms = static_cast<size_t>(extent.nelms());
+    if (nelms > 0) {
+        mxSetData(data, mxMalloc(nelms * mxGetElementSize(data)));
+    }
+
+    mxSetDimensions(data, dims.data(), dims.size());
+    return data;
+}
+
+void read_colmajor(const nix::DataSet &ds, nix::DataType dtype, size_t elsize, void *out,
+                   const nix::NDSize &count, const nix::NDSize &offset) {
+    const size_t rank = count.size();
+
+    if (count.nelms() == 0) {
+        return;
+    }
+
+    if (is_layout_invariant(count)) {
+        ds.getData(dtype, out, count, offset);
+        return;
+    }
+
+    //the data is read in row-major slabs of at most read_block_bytes,
+    // which are then transposed into place; find the axis to split
+    size_t axis = rank;
+    size_t inner = elsize;
+    for (size_t i = rank; i-- > 0;) {
+        if (inner * count[i] > read_block_bytes) {
+            axis = i;
+            break;
+        }
+        inner *= static_cast<size_t>(count[i]);
+    }
+
+    std::vector<size_t> strides = colmajor_strides(count);
+    char *dst = static_cast<char *>(out);
+
+    if (axis == rank) {
+        char *buf = scratch_buffer(inner);
+        ds.getData(dtype, buf, count, offset);
+        transpose_copy(buf, dst, elsize, count, strides);
+        return;
+    }
+
+    const size_t step = std::max<size_t>(1, read_block_bytes / inner);
+    char *buf = scratch_buffer(step * inner);
 
-    //NB: matlab is column-major, while HDF5 is row-major
-    //    data is correct with this, but dimensions don't
-    //    agree with the file anymore. Transpose it in matlab
-    //    (DataArray.read_all)
-    for (size_t i = 0; i < len; i++) {
-        dims[len - (i + 1)] = static_cast<mwSize>(size[i]);
+    nix::NDSize slab = count;
+    nix::NDSize pos(rank, 0);
+    for (size_t i = 0; i < axis; i++) {
+        slab[i] = 1;
     }
 
+    while (true) {
+        slab[axis] = std::min<nix::NDSize::value_type>(step, count[axis] - pos[axis]);
+
+        nix::NDSize slab_offset = offset;
+        size_t base = 0;
+        for (size_t i = 0; i <= axis; i++) {
+            slab_offset[i] += pos[i];
+            base += static_cast<size_t>(pos[i]) * strides[i];
+        }
+
+        ds.getData(dtype, buf, slab, slab_offset);
+        transpose_copy(buf, dst + base * elsize, elsize, slab, strides);
+
+        pos[axis] += slab[axis];
+        if (pos[axis] < count[axis]) {
+            continue;
+        }
+
+        pos[axis] = 0;
+        bool done = true;
+        for (size_t k = axis; k-- > 0;) {
+            if (++pos[k] < count[k]) {
+                done = false;
+                break;
+            }
+            pos[k] = 0;
+        }
+
+        if (done) {
+            break;
+        }
+    }
+}
+
+mxArray* make_mx_array_from_ds(const nix::DataSet &da) {
+    nix::NDSize size = da.dataExtent();
+    nix::NDSize offset(size.size(), 0);
+    return make_mx_array_from_ds(da, size, offset);
+}
+
+mxArray* make_mx_array_from_ds(const nix::DataSet &da, const nix::NDSize &count, const nix::NDSize &offset) {
     nix::DataType da_type = da.dataType();
     DType2 dtype = dtype_nix2mex(da_type);
 
@@ -22,15 +144,52 @@ mxArray* make_mx_array_from_ds(const nix::DataSet &da) {
         throw std::domain_error("Unsupported data type");
     }
 
-    mxArray *data = mxCreateNumericArray(dims.size(), dims.data(), dtype.cid, dtype.clx);
-    double *ptr = mxGetPr(data);
-
-    nix::NDSize offset(size.size(), 0);
-    da.getData(da_type, ptr, size, offset);
+    //NB: matlab is column-major, while HDF5 is row-major;
+    //    the data is transposed while reading, so the
+    //    dimensions of the result agree with the file
+    mxArray *data = make_mx_array_uninitialized(count, dtype);
+    read_colmajor(da, da_type, mxGetElementSize(data), mxGetData(data), count, offset);
 
     return data;
 }
 
+void check_mx_buffer(const mxArray *buf, DType2 dtype, const nix::NDSize &count) {
+    if (mxIsSparse(buf) || mxIsComplex(buf) || mxGetClassID(buf) != dtype.cid) {
+        throw std::invalid_argument("buffer class does not match the data type of the DataSet");
+    }
+
+    //trailing singleton dimensions are dropped by matlab
+    const size_t ndims = mxGetNumberOfDimensions(buf);
+    const mwSize *dims = mxGetDimensions(buf);
+    const size_t rank = std::max<size_t>(count.size(), 2);
+
+    for (size_t i = 0; i < std::max(ndims, rank); i++) {
+        const size_t have = i < ndims ? static_cast<size_t>(dims[i]) : 1;
+        size_t want = i < count.size() ? static_cast<size_t>(count[i]) : 1;
+
+        //1-d data is a row vector
+        if (count.size() == 1) {
+            want = i == 1 ? static_cast<size_t>(count[0]) : 1;
+        }
+
+        if (have != want) {
+            throw std::invalid_argument("buffer dimensions do not match the selection");
+        }
+    }
+}
+
+void fill_mx_array_from_ds(const nix::DataSet &da, mxArray *buf, const nix::NDSize &count, const nix::NDSize &offset) {
+    nix::DataType da_type = da.dataType();
+    DType2 dtype = dtype_nix2mex(da_type);
+
+    if (!dtype.is_valid) {
+        throw std::domain_error("Unsupported data type");
+    }
+
+    check_mx_buffer(buf, dtype, count);
+    read_colmajor(da, da_type, mxGetElementSize(buf), mxGetData(buf), count, offset);
+}
+
 mxArray* make_mx_array(const nix::NDSize &size)
 {
 	mxArray *res = mxCreateNumericMatrix(1, size.size(), mxUINT64_CLASS, mxREAL);
@@ -17,8 +17,22 @@ inline mxArray* make_mx_array(const std::string &s)
 	return mxCreateString(s.c_str());
 }
 
+mxArray* make_mx_array_uninitialized(const nix::NDSize &extent, DType2 dtype);
+
+void read_colmajor(const nix::DataSet &ds, nix::DataType dtype, size_t elsize, void *out,
+                   const nix::NDSize &count, const nix::NDSize &offset);
+
 mxArray* make_mx_array_from_ds(const nix::DataSet &da);
 
+mxArray* make_mx_array_from_ds(const nix::DataSet &da, const nix::NDSize &count, const nix::NDSize &offset);
+
+//throws unless buf is a real, dense array of class dtype in the shape
+//  that make_mx_array_uninitialized creates for count
+void check_mx_buffer(const mxArray *buf, DType2 dtype, const nix::NDSize &count);
+
+//reads the selection into the existing array buf, see check_mx_buffer
+void fill_mx_array_from_ds(const nix::DataSet &da, mxArray *buf, const nix::NDSize &count, const nix::NDSize &offset);
+
 mxArray* make_mx_array(const nix::Value &value);
 
 mxArray* make_mx_array(const nix::NDSize &size);
@@ -37,6 +37,27 @@ nix::NDSize mx_to_ndsize(const mxArray *arr) {
     return size;
 }
 
+nix::NDSize mx_to_extent(const mxArray *arr, size_t rank) {
+    /*
+    The extent of a (permuted) matlab array in file order, i.e. the
+    dimensions reversed. Matlab drops trailing singleton dimensions,
+    so they are padded back up to the rank of the target DataSet.
+    */
+    const mwSize ndims = mxGetNumberOfDimensions(arr);
+    const mwSize *dims = mxGetDimensions(arr);
+    nix::NDSize size(rank, 1);
+
+    for (size_t i = 0; i < ndims; i++) {
+        if (i < rank) {
+            size[rank - (i + 1)] = static_cast<nix::NDSize::value_type>(dims[i]);
+        } else if (dims[i] != 1) {
+            throw std::invalid_argument("data has more dimensions than the DataArray");
+        }
+    }
+
+    return size;
+}
+
 std::vector<std::string> mx_to_strings(const mxArray *arr) {
     /*
     To convert to a string vector we actually expect a cell
@@ -9,6 +9,8 @@ void check_arg_type(const mxArray *arr, nix::DataType dtype);
 
 nix::NDSize mx_to_ndsize(const mxArray *arr);
 
+nix::NDSize mx_to_extent(const mxArray *arr, size_t rank);
+
 std::vector<std::string> mx_to_strings(const mxArray *arr);
 
 nix::LinkType mx_to_linktype(const mxArray *arr);
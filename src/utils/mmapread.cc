@@ -0,0 +1,138 @@
+#include "mmapread.h"
+#include "h5util.h"
+#include "transpose.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+//the file descriptor of the file of the dataset, -1 if HDF5 does not
+// access it through one or it may have unwritten data
+static int file_descriptor(hid_t dset)
+{
+    h5_id file(H5Iget_file_id(dset));
+    unsigned int intent = 0;
+    if (!file.valid() || H5Fget_intent(file.get(), &intent) < 0 || (intent & H5F_ACC_RDWR)) {
+        return -1;
+    }
+
+    h5_id fapl(H5Fget_access_plist(file.get()));
+    if (!fapl.valid() || H5Pget_driver(fapl.get()) != H5FD_SEC2) {
+        return -1;
+    }
+
+    int *fd = nullptr;
+    if (H5Fget_vfd_handle(file.get(), fapl.get(), reinterpret_cast<void **>(&fd)) < 0 || fd == nullptr) {
+        return -1;
+    }
+
+    return *fd;
+}
+
+bool h5_mappable(hid_t dset, hid_t memtype)
+{
+    h5_id dcpl(H5Dget_create_plist(dset));
+    if (!dcpl.valid() || H5Pget_layout(dcpl.get()) != H5D_CONTIGUOUS ||
+        H5Pget_nfilters(dcpl.get()) != 0 || H5Pget_external_count(dcpl.get()) != 0) {
+        return false;
+    }
+
+    //not allocated before the first write, HDF5 knows the fill value
+    if (H5Dget_offset(dset) == HADDR_UNDEF) {
+        return false;
+    }
+
+    h5_id ftype(H5Dget_type(dset));
+    return H5Tequal(ftype.get(), memtype) > 0 && file_descriptor(dset) >= 0;
+}
+
+bool h5_read_mapped(hid_t dset, size_t elsize, const nix::NDSize &offset, const nix::NDSize &count,
+                    void *out, const std::vector<size_t> &dst_strides)
+{
+    const size_t rank = count.size();
+    if (count.nelms() == 0) {
+        return true;
+    }
+
+    const int fd = file_descriptor(dset);
+    const haddr_t base = H5Dget_offset(dset);
+    if (fd < 0 || base == HADDR_UNDEF) {
+        return false;
+    }
+
+    h5_id space(H5Dget_space(dset));
+    std::vector<hsize_t> dims(rank);
+    if (H5Sget_simple_extent_ndims(space.get()) != static_cast<int>(rank) ||
+        H5Sget_simple_extent_dims(space.get(), dims.data(), nullptr) < 0) {
+        return false;
+    }
+
+    //the span from the first to the last element of the selection
+    size_t first = 0, last = 0;
+    for (size_t k = 0; k < rank; k++) {
+        first = first * static_cast<size_t>(dims[k]) + static_cast<size_t>(offset[k]);
+        last = last * static_cast<size_t>(dims[k]) + static_cast<size_t>(offset[k] + count[k] - 1);
+    }
+
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = static_cast<size_t>(base) + first * elsize;
+    const size_t aligned = start / page * page;
+    const size_t length = start - aligned + (last - first + 1) * elsize;
+
+    void *map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(aligned));
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    madvise(map, length, MADV_SEQUENTIAL);
+    madvise(map, length, MADV_WILLNEED);
+
+    //the selection is a block of the dataset that starts here
+    const char *src = static_cast<const char *>(map) + (start - aligned);
+
+    //all but the first axis selected in full: the span is the block
+    bool whole = true;
+    for (size_t k = 1; k < rank; k++) {
+        whole = whole && count[k] == dims[k];
+    }
+
+    const bool rowmajor = is_rowmajor(count, dst_strides);
+
+    nix::NDSize shape(rank);
+    for (size_t k = 0; k < rank; k++) {
+        shape[k] = dims[k];
+    }
+
+    if (whole && rowmajor) {
+        memcpy(out, src, static_cast<size_t>(count.nelms()) * elsize);
+    } else if (whole) {
+        transpose_copy(src, out, elsize, count, dst_strides);
+    } else if (rowmajor) {
+        extract_block(src, shape, nix::NDSize(rank, 0), count, elsize, out);
+    } else {
+        std::vector<char> block(static_cast<size_t>(count.nelms()) * elsize);
+        extract_block(src, shape, nix::NDSize(rank, 0), count, elsize, block.data());
+        transpose_copy(block.data(), out, elsize, count, dst_strides);
+    }
+
+    munmap(map, length);
+    return true;
+}
+
+#else
+
+bool h5_mappable(hid_t dset, hid_t memtype)
+{
+    return false;
+}
+
+bool h5_read_mapped(hid_t dset, size_t elsize, const nix::NDSize &offset, const nix::NDSize &count,
+                    void *out, const std::vector<size_t> &dst_strides)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef NIX_MX_MMAPREAD_H
+#define NIX_MX_MMAPREAD_H
+
+#include <hdf5.h>
+#include <nix/NDSize.hpp>
+
+#include <vector>
+
+/*
+  Reads contiguous, unfiltered datasets without HDF5: the data is a
+  plain row-major array at a known offset in the file, so the span of
+  a selection is mapped and copied (or transposed) straight into the
+  output. Files in the system cache are read at memory bandwidth.
+
+  The file must be open read-only with the default (sec2) driver, so
+  that HDF5 holds no raw data the file does not have yet. POSIX only.
+*/
+
+//true if the dataset can be read from a mapping of its file: it is
+//  contiguous and allocated, and memtype needs no conversion
+bool h5_mappable(hid_t dset, hid_t memtype);
+
+//reads the block at offset (file order) into out, whose axes are laid
+//  out according to dst_strides (in elements); false if the file could
+//  not be mapped
+bool h5_read_mapped(hid_t dset, size_t elsize, const nix::NDSize &offset, const nix::NDSize &count,
+                    void *out, const std::vector<size_t> &dst_strides);
+
+#endif
@@ -0,0 +1,158 @@
+#include "prefetch.h"
+#include "h5select.h"
+#include "transpose.h"
+
+#include <chrono>
+#include <cstring>
+
+//how often a waiting worker checks whether its job is still wanted
+static const std::chrono::milliseconds poll_interval(10);
+
+prefetcher::prefetcher(h5_id dset, h5_id memtype, size_t elsize, size_t max_bytes)
+    : dset(std::move(dset)), memtype(std::move(memtype)), elsize(elsize), max_bytes(max_bytes),
+      state(job_state::idle), stopping(false)
+{
+    worker = std::thread(&prefetcher::run, this);
+}
+
+prefetcher::~prefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+
+    cv.notify_all();
+    worker.join();
+}
+
+bool prefetcher::take(const nix::NDSize &offset, const nix::NDSize &count,
+                      void *out, const std::vector<size_t> &dst_strides)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    const bool hit = state == job_state::ready && job_offset == offset && job_count == count;
+
+    //a pending job has not started, the caller holds h5_mutex;
+    // either way it is of no use anymore
+    state = job_state::idle;
+
+    if (!hit) {
+        return false;
+    }
+
+    if (is_rowmajor(count, dst_strides)) {
+        memcpy(out, buffer.data(), static_cast<size_t>(count.nelms()) * elsize);
+    } else {
+        transpose_copy(buffer.data(), out, elsize, count, dst_strides);
+    }
+
+    return true;
+}
+
+void prefetcher::observed(const nix::NDSize &offset, const nix::NDSize &count,
+                          const nix::NDSize &extent)
+{
+    const size_t rank = offset.size();
+    nix::NDSize next = offset;
+
+    //keep the step between the last two reads, or else move on by one
+    // block along the last axis that is not read completely
+    bool stepped = false;
+    if (last_offset.size() == rank && last_offset != offset) {
+        for (size_t i = 0; i < rank; i++) {
+            next[i] = 2 * offset[i] - last_offset[i];
+            //steps backwards are not followed
+            if (offset[i] < last_offset[i]) {
+                next[i] = offset[i];
+            }
+        }
+        stepped = next != offset;
+    }
+
+    if (!stepped) {
+        for (size_t i = rank; i-- > 0;) {
+            if (count[i] < extent[i]) {
+                next[i] += count[i];
+                stepped = true;
+                break;
+            }
+        }
+    }
+
+    last_offset = offset;
+
+    bool fits = stepped && count.nelms() * elsize <= max_bytes;
+    for (size_t i = 0; fits && i < rank; i++) {
+        fits = next[i] + count[i] <= extent[i];
+    }
+
+    if (!fits) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job_offset = next;
+        job_count = count;
+        state = job_state::pending;
+    }
+
+    cv.notify_all();
+}
+
+void prefetcher::discard()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    state = job_state::idle;
+    last_offset = nix::NDSize();
+}
+
+void prefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+        cv.wait(lock, [this] { return stopping || state == job_state::pending; });
+
+        if (stopping) {
+            return;
+        }
+
+        //wait for the current command to finish, unless the job is dropped
+        std::unique_lock<std::timed_mutex> h5(h5_mutex(), std::defer_lock);
+        bool wanted = true;
+
+        while (wanted) {
+            lock.unlock();
+            const bool locked = h5.try_lock_for(poll_interval);
+            lock.lock();
+
+            wanted = !stopping && state == job_state::pending;
+            if (locked) {
+                break;
+            }
+        }
+
+        if (!wanted) {
+            continue;
+        }
+
+        const std::vector<hsize_t> offset(job_offset.begin(), job_offset.end());
+        const std::vector<hsize_t> count(job_count.begin(), job_count.end());
+        lock.unlock();
+
+        //no command runs, so nobody else touches the buffer
+        bool ok = true;
+        try {
+            buffer.resize(static_cast<size_t>(job_count.nelms()) * elsize);
+            h5_read_hyperslab(dset.get(), memtype.get(), offset, count, buffer.data());
+        } catch (const std::exception &) {
+            ok = false;
+        }
+
+        lock.lock();
+        state = ok ? job_state::ready : job_state::failed;
+        h5.unlock();
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef NIX_MX_PREFETCH_H
+#define NIX_MX_PREFETCH_H
+
+#include "h5util.h"
+
+#include <nix/NDSize.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  Reads the block following the last read of a sequential scan in
+  a worker thread, while matlab works on the current one. The worker
+  only touches HDF5 while holding h5_mutex, i.e. in between commands,
+  and never the mex API; a hit only copies the buffer.
+
+  Positions are in file order; take() and observed() must be called
+  with h5_mutex held (as every command does).
+*/
+class prefetcher {
+public:
+    prefetcher(h5_id dset, h5_id memtype, size_t elsize, size_t max_bytes);
+
+    ~prefetcher();
+
+    prefetcher(const prefetcher &other) = delete;
+    prefetcher &operator=(const prefetcher &other) = delete;
+
+    //copies the block into out if it has been read ahead,
+    //  dst_strides are the strides of out along the file axes
+    bool take(const nix::NDSize &offset, const nix::NDSize &count,
+              void *out, const std::vector<size_t> &dst_strides);
+
+    //the block has been read: predict the next one and fetch it
+    void observed(const nix::NDSize &offset, const nix::NDSize &count,
+                  const nix::NDSize &extent);
+
+    //drops what has been read ahead, e.g. after a write
+    void discard();
+
+private:
+    enum class job_state { idle, pending, ready, failed };
+
+    void run();
+
+    h5_id dset;
+    h5_id memtype;
+    size_t elsize;
+    size_t max_bytes;
+
+    //guard state and job, the buffer belongs to whoever holds h5_mutex
+    std::mutex mtx;
+    std::condition_variable cv;
+    job_state state;
+    bool stopping;
+    nix::NDSize job_offset;
+    nix::NDSize job_count;
+    std::vector<char> buffer;
+
+    //last read, to guess the step of the scan
+    nix::NDSize last_offset;
+
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "readerpool.h"
+#include "transpose.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#ifndef MSG_NOSIGNAL
+//SO_NOSIGPIPE is set on the socket instead
+#define MSG_NOSIGNAL 0
+#endif
+
+static bool send_all(int sock, const void *data, size_t n)
+{
+    const char *p = static_cast<const char *>(data);
+
+    while (n > 0) {
+        const ssize_t res = ::send(sock, p, n, MSG_NOSIGNAL);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        n -= static_cast<size_t>(res);
+    }
+
+    return true;
+}
+
+static bool recv_all(int sock, void *data, size_t n)
+{
+    char *p = static_cast<char *>(data);
+
+    while (n > 0) {
+        const ssize_t res = ::recv(sock, p, n, 0);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        n -= static_cast<size_t>(res);
+    }
+
+    return true;
+}
+
+//reads a reply and its message, false if the process is gone
+static bool recv_reply(int sock, reader_reply &reply, std::string &msg)
+{
+    if (!recv_all(sock, &reply, sizeof(reply))) {
+        return false;
+    }
+
+    msg.resize(reply.msg_bytes);
+    return reply.msg_bytes == 0 || recv_all(sock, &msg[0], reply.msg_bytes);
+}
+
+reader_pool::reader_pool(const std::string &file, size_t procs, const std::string &program,
+                         size_t buffer_bytes, bool swmr)
+    : file(file), buffer_bytes(buffer_bytes)
+{
+    if (procs == 0) {
+        throw std::invalid_argument("at least one reader process is needed");
+    }
+
+    if (buffer_bytes < 8) {
+        throw std::invalid_argument("the buffer of a reader process must hold one element");
+    }
+
+    try {
+        for (size_t i = 0; i < procs; i++) {
+            start(program, swmr);
+        }
+    } catch (...) {
+        for (process &p : this->procs) {
+            stop(p);
+        }
+        throw;
+    }
+}
+
+reader_pool::~reader_pool()
+{
+    for (process &p : procs) {
+        stop(p);
+    }
+}
+
+std::string reader_pool::default_program()
+{
+    static const char anchor = 0;
+    Dl_info info;
+
+    if (dladdr(&anchor, &info) == 0 || info.dli_fname == nullptr) {
+        throw std::runtime_error("could not locate nix_mx");
+    }
+
+    std::string path = info.dli_fname;
+    const size_t slash = path.rfind('/');
+    path = slash == std::string::npos ? "." : path.substr(0, slash);
+    return path + "/nix_mx_reader";
+}
+
+void reader_pool::start(const std::string &program, bool swmr)
+{
+    static unsigned int counter = 0;
+    const std::string shm_name = "/nix_mx_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+
+    const int shm = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shm < 0) {
+        throw std::runtime_error("could not create shared memory for a reader process");
+    }
+
+    void *buffer = MAP_FAILED;
+    if (ftruncate(shm, static_cast<off_t>(buffer_bytes)) == 0) {
+        buffer = mmap(nullptr, buffer_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    }
+    close(shm);
+
+    int sv[2];
+    if (buffer == MAP_FAILED || socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        if (buffer != MAP_FAILED) {
+            munmap(buffer, buffer_bytes);
+        }
+        shm_unlink(shm_name.c_str());
+        throw std::runtime_error("could not set up a reader process");
+    }
+
+    //only the end of the process is inherited
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    const std::string fd = std::to_string(sv[1]);
+    const std::string bytes = std::to_string(buffer_bytes);
+    std::vector<char *> argv = {
+        const_cast<char *>(program.c_str()), const_cast<char *>(file.c_str()),
+        const_cast<char *>(fd.c_str()), const_cast<char *>(shm_name.c_str()),
+        const_cast<char *>(bytes.c_str()), const_cast<char *>(swmr ? "1" : "0"), nullptr
+    };
+
+    pid_t pid = 0;
+    const int err = posix_spawn(&pid, program.c_str(), nullptr, nullptr, argv.data(), environ);
+    close(sv[1]);
+
+    process p { err == 0 ? static_cast<int>(pid) : -1, sv[0], buffer, nullptr };
+
+    //the process has mapped the memory once it answers
+    reader_reply reply;
+    std::string msg;
+    const bool ready = err == 0 && recv_reply(p.sock, reply, msg);
+    shm_unlink(shm_name.c_str());
+
+    if (!ready || reply.status != 0) {
+        stop(p);
+        throw std::runtime_error(ready ? "reader process: " + msg :
+                                 "could not start reader process " + program);
+    }
+
+    procs.push_back(p);
+}
+
+void reader_pool::stop(process &p)
+{
+    //the process ends when the socket closes
+    if (p.sock >= 0) {
+        close(p.sock);
+        p.sock = -1;
+    }
+
+    if (p.pid > 0) {
+        while (waitpid(p.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+        p.pid = -1;
+    }
+
+    if (p.buffer != nullptr) {
+        munmap(p.buffer, buffer_bytes);
+        p.buffer = nullptr;
+    }
+}
+
+void reader_pool::split(const job &j, std::vector<piece> &pieces) const
+{
+    const size_t rank = j.count.size();
+    if (j.count.nelms() == 0) {
+        return;
+    }
+
+    //the first axis along which a number of the blocks spanned by
+    // the following axes fits into the buffer
+    size_t axis = 0;
+    size_t tail = static_cast<size_t>(j.count.nelms() / j.count[0]) * j.elsize;
+    while (tail > buffer_bytes) {
+        axis++;
+        tail /= static_cast<size_t>(j.count[axis]);
+    }
+    const nix::ndsize_t step = std::min<nix::ndsize_t>(j.count[axis], buffer_bytes / tail);
+
+    nix::NDSize pos(rank, 0);
+    while (true) {
+        for (nix::ndsize_t i = 0; i < j.count[axis]; i += step) {
+            piece pc;
+            pc.origin = &j;
+            pc.offset = j.offset;
+            pc.count = j.count;
+
+            size_t dst = 0;
+            for (size_t k = 0; k < axis; k++) {
+                pc.offset[k] += pos[k];
+                pc.count[k] = 1;
+                dst += static_cast<size_t>(pos[k]) * j.dst_strides[k];
+            }
+            pc.offset[axis] += i;
+            pc.count[axis] = std::min(step, j.count[axis] - i);
+            dst += static_cast<size_t>(i) * j.dst_strides[axis];
+
+            pc.out = static_cast<char *>(j.out) + dst * j.elsize;
+            pieces.push_back(pc);
+        }
+
+        //next position of the leading axes
+        size_t k = axis;
+        while (k-- > 0) {
+            if (++pos[k] < j.count[k]) {
+                break;
+            }
+            pos[k] = 0;
+        }
+        if (k == static_cast<size_t>(-1)) {
+            return;
+        }
+    }
+}
+
+void reader_pool::send(process &p, const piece &pc)
+{
+    const job &j = *pc.origin;
+    const size_t rank = pc.count.size();
+
+    reader_request req;
+    req.type = static_cast<uint32_t>(j.type);
+    req.rank = static_cast<uint32_t>(rank);
+    req.path_bytes = static_cast<uint32_t>(j.dataset.size());
+
+    std::vector<uint64_t> sel(2 * rank);
+    for (size_t k = 0; k < rank; k++) {
+        sel[k] = pc.offset[k];
+        sel[rank + k] = pc.count[k];
+    }
+
+    if (!send_all(p.sock, &req, sizeof(req)) || !send_all(p.sock, j.dataset.data(), j.dataset.size()) ||
+        !send_all(p.sock, sel.data(), sel.size() * sizeof(uint64_t))) {
+        throw std::runtime_error("reader process ended unexpectedly");
+    }
+
+    p.current = &pc;
+}
+
+void reader_pool::receive(process &p, std::string &error)
+{
+    const piece &pc = *p.current;
+    p.current = nullptr;
+
+    reader_reply reply;
+    std::string msg;
+    if (!recv_reply(p.sock, reply, msg)) {
+        if (error.empty()) {
+            error = "reader process ended unexpectedly";
+        }
+        return;
+    }
+
+    if (reply.status != 0) {
+        if (error.empty()) {
+            error = "reader process: " + msg;
+        }
+        return;
+    }
+
+    const job &j = *pc.origin;
+    if (is_rowmajor(pc.count, j.dst_strides)) {
+        memcpy(pc.out, p.buffer, static_cast<size_t>(reply.nbytes));
+    } else {
+        transpose_copy(p.buffer, pc.out, j.elsize, pc.count, j.dst_strides);
+    }
+}
+
+void reader_pool::read(const std::vector<job> &jobs)
+{
+    std::vector<piece> pieces;
+    for (const job &j : jobs) {
+        split(j, pieces);
+    }
+
+    size_t next = 0;
+    std::string error;
+    std::vector<pollfd> fds;
+    std::vector<process *> busy;
+
+    while (true) {
+        //hand out work to idle processes, until something failed
+        for (process &p : procs) {
+            if (p.current == nullptr && next < pieces.size() && error.empty()) {
+                try {
+                    send(p, pieces[next]);
+                    next++;
+                } catch (const std::exception &e) {
+                    error = e.what();
+                }
+            }
+        }
+
+        fds.clear();
+        busy.clear();
+        for (process &p : procs) {
+            if (p.current != nullptr) {
+                pollfd pfd { p.sock, POLLIN, 0 };
+                fds.push_back(pfd);
+                busy.push_back(&p);
+            }
+        }
+
+        if (busy.empty()) {
+            break;
+        }
+
+        if (poll(fds.data(), static_cast<nfds_t>(fds.size()), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            //the replies of the busy processes cannot be told apart anymore
+            throw std::runtime_error("waiting for reader processes failed");
+        }
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents != 0) {
+                receive(*busy[i], error);
+            }
+        }
+    }
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+#else
+
+reader_pool::reader_pool(const std::string &file, size_t procs, const std::string &program,
+                         size_t buffer_bytes, bool swmr)
+    : file(file), buffer_bytes(buffer_bytes)
+{
+    throw std::runtime_error("reader processes are not supported on this platform");
+}
+
+reader_pool::~reader_pool()
+{
+}
+
+std::string reader_pool::default_program()
+{
+    return "nix_mx_reader.exe";
+}
+
+void reader_pool::read(const std::vector<job> &jobs)
+{
+}
+
+#endif
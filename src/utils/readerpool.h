@@ -0,0 +1,83 @@
+#ifndef NIX_MX_READERPOOL_H
+#define NIX_MX_READERPOOL_H
+
+#include "readerproto.h"
+
+#include <nix/NDSize.hpp>
+
+#include <string>
+#include <vector>
+
+/*
+  Local processes that open a file read-only and read blocks of its
+  datasets on request. Each process has its own HDF5 library, so they
+  read in parallel; the data is passed back in shared memory and
+  copied into place by the calling thread. Blocks larger than the
+  shared memory of a process are read piece by piece.
+
+  The processes run the program nix_mx_reader, which is installed
+  next to nix_mx. POSIX only.
+*/
+class reader_pool {
+public:
+    struct job {
+        std::string dataset;     //path of the dataset in the file
+        reader_type type;
+        size_t elsize;
+        nix::NDSize offset;      //file order
+        nix::NDSize count;
+        void *out;
+        std::vector<size_t> dst_strides; //axes of out, in elements
+    };
+
+    //starts the processes; swmr opens the file for SWMR reading
+    reader_pool(const std::string &file, size_t procs, const std::string &program,
+                size_t buffer_bytes, bool swmr);
+
+    //ends the processes
+    ~reader_pool();
+
+    reader_pool(const reader_pool &other) = delete;
+    reader_pool &operator=(const reader_pool &other) = delete;
+
+    //runs the jobs, throws the first error once all reads are done
+    void read(const std::vector<job> &jobs);
+
+    size_t size() const {
+        return procs.size();
+    }
+
+    const std::string &file_name() const {
+        return file;
+    }
+
+    //the default program: nix_mx_reader in the directory of nix_mx
+    static std::string default_program();
+
+private:
+    struct piece {
+        const job *origin;
+        nix::NDSize offset; //within the dataset
+        nix::NDSize count;
+        char *out;
+    };
+
+    struct process {
+        int pid;
+        int sock;
+        void *buffer;
+        const piece *current;
+    };
+
+    void start(const std::string &program, bool swmr);
+    void stop(process &p);
+    void split(const job &j, std::vector<piece> &pieces) const;
+    void send(process &p, const piece &pc);
+    void receive(process &p, std::string &error);
+
+    std::string file;
+    size_t buffer_bytes;
+    std::vector<process> procs;
+};
+
+#endif
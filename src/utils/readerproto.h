@@ -0,0 +1,39 @@
+#ifndef NIX_MX_READERPROTO_H
+#define NIX_MX_READERPROTO_H
+
+#include <cstdint>
+
+/*
+  Messages between nix_mx and its reader processes (see readerpool.h),
+  exchanged over a local socket; the data itself is placed in memory
+  shared with the process. Both sides run on the same machine, so
+  everything is sent in native byte order.
+
+  The process is started as
+      nix_mx_reader <file> <socket fd> <shared memory name> <bytes> <swmr>
+  and answers with a reader_reply once it is ready. Every request is a
+  reader_request, followed by the dataset path and the offset and
+  count (file order, uint64_t each); it is answered by a reader_reply,
+  followed by msg_bytes of error message if status is not 0.
+*/
+
+//in-memory type of the data
+enum class reader_type : uint32_t {
+    int8, uint8, int16, uint16, int32, uint32, int64, uint64,
+    float32, float64,
+    stored //the type in the file, e.g. the enum of booleans
+};
+
+struct reader_request {
+    uint32_t type;
+    uint32_t rank;
+    uint32_t path_bytes;
+};
+
+struct reader_reply {
+    int32_t status;
+    uint32_t msg_bytes;
+    uint64_t nbytes;
+};
+
+#endif
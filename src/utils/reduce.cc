@@ -0,0 +1,258 @@
+#include "reduce.h"
+#include "h5util.h"
+#include "h5select.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+static const double not_a_number = std::numeric_limits<double>::quiet_NaN();
+static const double infinity = std::numeric_limits<double>::infinity();
+
+static size_t product(const nix::NDSize &size, size_t from, size_t to)
+{
+    size_t n = 1;
+    for (size_t k = from; k < to; k++) {
+        n *= static_cast<size_t>(size[k]);
+    }
+    return n;
+}
+
+axis_reducer::axis_reducer(const nix::NDSize &extent, size_t axis, const std::vector<double> &edges)
+    : extent(extent), axis(axis), edges(edges), uniform(false)
+{
+    if (axis >= extent.size()) {
+        throw std::invalid_argument("the axis exceeds the rank of the DataArray");
+    }
+
+    for (size_t k = 1; k < edges.size(); k++) {
+        if (!(edges[k] > edges[k - 1])) {
+            throw std::invalid_argument("histogram edges must increase");
+        }
+    }
+
+    if (edges.size() == 1) {
+        throw std::invalid_argument("histograms need at least two edges");
+    }
+
+    //equally spaced edges map values to bins without a search
+    if (edges.size() > 2) {
+        const double width = (edges.back() - edges.front()) / (edges.size() - 1);
+        uniform = true;
+        for (size_t k = 0; k < edges.size(); k++) {
+            uniform = uniform && std::fabs(edges[k] - (edges.front() + k * width)) <= 1e-9 * width;
+        }
+    }
+
+    mid = axis == 0 ? 1 : product(extent, 1, axis);
+    inner = product(extent, axis + 1, extent.size());
+
+    const size_t n = cells();
+    counts.assign(n, 0);
+    means.assign(n, 0);
+    m2s.assign(n, 0);
+    lows.assign(n, infinity);
+    highs.assign(n, -infinity);
+
+    if (edges.size() > 0) {
+        hist.assign(n * (edges.size() - 1), 0);
+    }
+
+    sum.resize(inner);
+    dev.resize(inner);
+    lo.resize(inner);
+    hi.resize(inner);
+}
+
+size_t axis_reducer::cells() const
+{
+    return product(extent, 0, axis) * inner;
+}
+
+void axis_reducer::add(const double *values, size_t first, size_t rows)
+{
+    if (inner == 0 || rows == 0) {
+        return;
+    }
+
+    if (axis == 0) {
+        merge(values, rows, 0, 0);
+        return;
+    }
+
+    //every slab holds whole runs along the axis
+    const size_t len = static_cast<size_t>(extent[axis]);
+    const size_t outer = rows * mid;
+    for (size_t o = 0; o < outer; o++) {
+        const size_t global = first * mid + o;
+        merge(values + o * len * inner, len, global * inner, global);
+    }
+}
+
+//reduces len runs of inner values and merges them into the cells from
+// `cell` on; outer is the index of the cells along the leading axes
+void axis_reducer::merge(const double *values, size_t len, size_t cell, size_t outer)
+{
+    if (len == 0) {
+        return;
+    }
+
+    std::fill(sum.begin(), sum.end(), 0);
+    std::fill(dev.begin(), dev.end(), 0);
+    std::fill(lo.begin(), lo.end(), infinity);
+    std::fill(hi.begin(), hi.end(), -infinity);
+
+    for (size_t l = 0; l < len; l++) {
+        const double *row = values + l * inner;
+        for (size_t i = 0; i < inner; i++) {
+            sum[i] += row[i];
+            lo[i] = row[i] < lo[i] ? row[i] : lo[i];
+            hi[i] = row[i] > hi[i] ? row[i] : hi[i];
+        }
+    }
+
+    //deviations from the mean of the slab, in a second pass
+    const double nb = static_cast<double>(len);
+    for (size_t i = 0; i < inner; i++) {
+        sum[i] /= nb;
+    }
+
+    for (size_t l = 0; l < len; l++) {
+        const double *row = values + l * inner;
+        for (size_t i = 0; i < inner; i++) {
+            const double d = row[i] - sum[i];
+            dev[i] += d * d;
+        }
+    }
+
+    for (size_t i = 0; i < inner; i++) {
+        const size_t c = cell + i;
+        const double na = counts[c];
+        const double n = na + nb;
+        const double delta = sum[i] - means[c];
+
+        means[c] += delta * nb / n;
+        m2s[c] += dev[i] + delta * delta * na * nb / n;
+        counts[c] = n;
+        lows[c] = std::min(lows[c], lo[i]);
+        highs[c] = std::max(highs[c], hi[i]);
+    }
+
+    if (edges.empty()) {
+        return;
+    }
+
+    const size_t nbins = edges.size() - 1;
+    const double first = edges.front(), last = edges.back();
+    const double width = (last - first) / nbins;
+    double *h = hist.data() + outer * nbins * inner;
+
+    for (size_t l = 0; l < len; l++) {
+        const double *row = values + l * inner;
+        for (size_t i = 0; i < inner; i++) {
+            const double x = row[i];
+            if (!(x >= first && x <= last)) {
+                continue;
+            }
+
+            size_t b;
+            if (uniform) {
+                b = std::min(static_cast<size_t>((x - first) / width), nbins - 1);
+                //rounding may put values next to an edge into the wrong bin
+                if (b > 0 && x < edges[b]) {
+                    b--;
+                } else if (b + 1 < nbins && x >= edges[b + 1]) {
+                    b++;
+                }
+            } else {
+                b = static_cast<size_t>(std::upper_bound(edges.begin(), edges.end(), x) - edges.begin());
+                b = std::min(b - 1, nbins - 1);
+            }
+
+            h[b * inner + i] += 1;
+        }
+    }
+}
+
+void axis_reducer::mean(double *out) const
+{
+    for (size_t c = 0; c < counts.size(); c++) {
+        out[c] = counts[c] > 0 ? means[c] : not_a_number;
+    }
+}
+
+void axis_reducer::std_dev(double *out) const
+{
+    for (size_t c = 0; c < counts.size(); c++) {
+        out[c] = counts[c] > 0 ? std::sqrt(m2s[c] / std::max(counts[c] - 1, 1.0)) : not_a_number;
+    }
+}
+
+//cells of only NaN have not moved their bounds
+void axis_reducer::min(double *out) const
+{
+    for (size_t c = 0; c < counts.size(); c++) {
+        out[c] = lows[c] <= highs[c] ? lows[c] : not_a_number;
+    }
+}
+
+void axis_reducer::max(double *out) const
+{
+    for (size_t c = 0; c < counts.size(); c++) {
+        out[c] = lows[c] <= highs[c] ? highs[c] : not_a_number;
+    }
+}
+
+void axis_reducer::rms(double *out) const
+{
+    //the mean square is the squared mean plus the biased variance
+    for (size_t c = 0; c < counts.size(); c++) {
+        out[c] = counts[c] > 0 ? std::sqrt(means[c] * means[c] + m2s[c] / counts[c]) : not_a_number;
+    }
+}
+
+void axis_reducer::histogram(double *out) const
+{
+    std::copy(hist.begin(), hist.end(), out);
+}
+
+void h5_reduce(hid_t dset, nix::DataType dtype, const polynomial &p, axis_reducer &r,
+               const nix::NDSize &extent, size_t block_bytes)
+{
+    const size_t rank = extent.size();
+    if (extent.nelms() == 0) {
+        return;
+    }
+
+    h5_id memtype = h5_mem_type(dset, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+
+    //slabs along the first axis, of whole chunks if possible
+    const size_t row = static_cast<size_t>(extent.nelms() / extent[0]);
+    size_t rows = std::max<size_t>(1, block_bytes / (row * sizeof(double)));
+
+    nix::NDSize chunks = h5_chunk_extent(dset);
+    if (chunks.size() == rank) {
+        const size_t quantum = static_cast<size_t>(chunks[0]);
+        rows = std::max(quantum, rows / quantum * quantum);
+    }
+
+    std::vector<hsize_t> h_offset(rank, 0);
+    std::vector<hsize_t> h_count(extent.begin(), extent.end());
+    std::vector<char> raw;
+    std::vector<double> values;
+
+    for (size_t first = 0; first < extent[0]; first += rows) {
+        h_offset[0] = first;
+        h_count[0] = std::min<hsize_t>(rows, extent[0] - first);
+
+        const size_t n = static_cast<size_t>(h_count[0]) * row;
+        raw.resize(n * elsize);
+        values.resize(n);
+
+        h5_read_hyperslab(dset, memtype.get(), h_offset, h_count, raw.data());
+        apply_polynomial(p, dtype, raw.data(), n, false, values.data());
+        r.add(values.data(), first, static_cast<size_t>(h_count[0]));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef NIX_MX_REDUCE_H
+#define NIX_MX_REDUCE_H
+
+#include "calibrate.h"
+
+#include <hdf5.h>
+#include <nix/DataType.hpp>
+#include <nix/NDSize.hpp>
+
+#include <vector>
+
+/*
+  Statistics along one axis of a dataset, computed while it is read
+  in slabs: every slab is reduced to per-cell counts, means, sums of
+  squared deviations, minima and maxima with plain loops over the
+  contiguous trailing axes (which compilers vectorize), and merged
+  into the running results with the pairwise update of Chan et al.,
+  the block form of Welford's algorithm. Histograms count per cell.
+
+  A cell is a position of the extent without the reduced axis; all
+  results are row-major in file order, with the axis dropped or, for
+  histograms, replaced by the bins.
+*/
+class axis_reducer {
+public:
+    //edges of the histogram bins, none for no histogram; bins are
+    //  [e(k), e(k+1)), the last one includes its right edge
+    axis_reducer(const nix::NDSize &extent, size_t axis, const std::vector<double> &edges);
+
+    //adds the row-major values of [first, first + rows) along axis 0
+    void add(const double *values, size_t first, size_t rows);
+
+    size_t cells() const;
+
+    //NaN for cells without values; minima and maxima ignore NaN
+    void mean(double *out) const;
+
+    //normalized by n - 1 like matlab's std, 0 for a single value
+    void std_dev(double *out) const;
+
+    void min(double *out) const;
+
+    void max(double *out) const;
+
+    void rms(double *out) const;
+
+    void histogram(double *out) const;
+
+private:
+    void merge(const double *values, size_t len, size_t cell, size_t outer);
+
+    nix::NDSize extent;
+    size_t axis;
+    size_t mid;    //elements of the axes between 0 and axis
+    size_t inner;  //elements of the axes after axis
+
+    std::vector<double> edges;
+    bool uniform;
+
+    std::vector<double> counts, means, m2s, lows, highs, hist;
+
+    //per slab
+    std::vector<double> sum, dev, lo, hi;
+};
+
+//streams the block [0, extent) of the dataset of type dtype through
+//  the reducer, calibrated with p, at most block_bytes at a time
+void h5_reduce(hid_t dset, nix::DataType dtype, const polynomial &p, axis_reducer &r,
+               const nix::NDSize &extent, size_t block_bytes);
+
+#endif
@@ -0,0 +1,340 @@
+#include "shmcache.h"
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static const uint64_t cache_magic = 0x6e69786d78636331ULL; //"nixmxcc1"
+
+//how long to wait for another process to set up the memory
+static const std::chrono::seconds setup_timeout(5);
+
+struct shared_chunk_cache::header {
+    uint64_t magic;
+    uint64_t bytes;
+    uint64_t slot_bytes;
+    uint64_t nslots;
+    uint64_t clock;
+    pthread_mutex_t lock;
+    std::atomic<uint32_t> ready;
+};
+
+struct shared_chunk_cache::slot {
+    uint64_t a;
+    uint64_t b;
+    uint64_t nbytes;
+    uint64_t last_use;
+    uint32_t full;
+    uint32_t unused;
+};
+
+static size_t align(size_t n)
+{
+    return (n + 63) / 64 * 64;
+}
+
+static std::string shm_name(const std::string &name)
+{
+    return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+}
+
+//holds the process-shared mutex; the lock of a process that died
+// holding it is taken over, a slot it was filling is still empty
+class shm_lock {
+public:
+    explicit shm_lock(pthread_mutex_t *m) : m(m) {
+        const int res = pthread_mutex_lock(m);
+#ifdef __linux__
+        if (res == EOWNERDEAD) {
+            pthread_mutex_consistent(m);
+            return;
+        }
+#endif
+        if (res != 0) {
+            throw std::runtime_error("could not lock the shared chunk cache");
+        }
+    }
+
+    ~shm_lock() {
+        pthread_mutex_unlock(m);
+    }
+
+private:
+    pthread_mutex_t *m;
+};
+
+//caches attached by this process, by name
+static std::mutex attached_mtx;
+static std::map<std::string, std::weak_ptr<shared_chunk_cache>> attached;
+
+std::shared_ptr<shared_chunk_cache> shared_chunk_cache::attach(const std::string &name, size_t bytes,
+                                                               size_t slot_bytes)
+{
+    const std::string path = shm_name(name);
+
+    std::lock_guard<std::mutex> guard(attached_mtx);
+    auto it = attached.find(path);
+    if (it != attached.end()) {
+        if (std::shared_ptr<shared_chunk_cache> cache = it->second.lock()) {
+            return cache;
+        }
+    }
+
+    const size_t table = align(sizeof(header));
+    if (slot_bytes == 0 || bytes < table + sizeof(slot) + slot_bytes) {
+        throw std::invalid_argument("the shared chunk cache must hold at least one slot");
+    }
+
+    void *base = MAP_FAILED;
+    size_t size = bytes;
+
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+
+        if (base == MAP_FAILED) {
+            shm_unlink(path.c_str());
+            throw std::runtime_error("could not create the shared chunk cache " + name);
+        }
+
+        header *h = new (base) header();
+        h->bytes = bytes;
+        h->slot_bytes = slot_bytes;
+        h->nslots = (bytes - table) / (sizeof(slot) + slot_bytes);
+        h->clock = 0;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+        pthread_mutex_init(&h->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        //the slots are zero, i.e. empty
+        h->magic = cache_magic;
+        h->ready.store(1, std::memory_order_release);
+    } else if (errno == EEXIST) {
+        fd = shm_open(path.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("could not open the shared chunk cache " + name);
+        }
+
+        //the creator may not have sized it yet
+        const auto deadline = std::chrono::steady_clock::now() + setup_timeout;
+        struct stat st;
+        while (fstat(fd, &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        size = static_cast<size_t>(st.st_size);
+        if (size >= sizeof(header)) {
+            base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("could not map the shared chunk cache " + name);
+        }
+
+        header *h = static_cast<header *>(base);
+        while (h->ready.load(std::memory_order_acquire) == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (h->ready.load(std::memory_order_acquire) == 0 || h->magic != cache_magic || h->bytes != size) {
+            munmap(base, size);
+            throw std::runtime_error("shared memory " + name + " is not a chunk cache of nix-mx");
+        }
+    } else {
+        throw std::runtime_error("could not create the shared chunk cache " + name);
+    }
+
+    std::shared_ptr<shared_chunk_cache> cache(new shared_chunk_cache(base, size));
+    attached[path] = cache;
+    return cache;
+}
+
+void shared_chunk_cache::remove(const std::string &name)
+{
+    if (shm_unlink(shm_name(name).c_str()) != 0 && errno != ENOENT) {
+        throw std::runtime_error("could not remove the shared chunk cache " + name);
+    }
+}
+
+std::string shared_chunk_cache::file_key(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("could not stat " + path);
+    }
+
+    //rewrites within a second must change the key as well
+#ifdef __APPLE__
+    const struct timespec &mtime = st.st_mtimespec;
+#else
+    const struct timespec &mtime = st.st_mtim;
+#endif
+
+    return std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" +
+        std::to_string(st.st_size) + ":" + std::to_string(mtime.tv_sec) + "." +
+        std::to_string(mtime.tv_nsec) + ":";
+}
+
+shared_chunk_cache::shared_chunk_cache(void *base, size_t bytes)
+    : head(static_cast<header *>(base)), mapped(bytes)
+{
+    char *p = static_cast<char *>(base);
+    slots = reinterpret_cast<slot *>(p + align(sizeof(header)));
+    data = reinterpret_cast<char *>(slots + head->nslots);
+}
+
+shared_chunk_cache::~shared_chunk_cache()
+{
+    munmap(head, mapped);
+}
+
+#else
+
+struct shared_chunk_cache::header {
+    uint64_t slot_bytes;
+    uint64_t nslots;
+};
+
+struct shared_chunk_cache::slot {
+};
+
+std::shared_ptr<shared_chunk_cache> shared_chunk_cache::attach(const std::string &name, size_t bytes,
+                                                               size_t slot_bytes)
+{
+    throw std::runtime_error("shared chunk caches are not supported on this platform");
+}
+
+void shared_chunk_cache::remove(const std::string &name)
+{
+}
+
+std::string shared_chunk_cache::file_key(const std::string &path)
+{
+    return path;
+}
+
+shared_chunk_cache::~shared_chunk_cache()
+{
+}
+
+#endif
+
+//FNV-1a, with a second basis for the other half of the key
+static void hash_bytes(shm_key &key, const void *data, size_t n)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < n; i++) {
+        key.a = (key.a ^ p[i]) * 0x100000001b3ULL;
+        key.b = (key.b ^ p[i]) * 0x100000001b3ULL;
+    }
+}
+
+shm_key shared_chunk_cache::make_key(const std::string &prefix, const std::vector<uint64_t> &offset)
+{
+    shm_key key { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+    hash_bytes(key, prefix.data(), prefix.size());
+    hash_bytes(key, offset.data(), offset.size() * sizeof(uint64_t));
+    return key;
+}
+
+size_t shared_chunk_cache::slot_bytes() const
+{
+    return static_cast<size_t>(head->slot_bytes);
+}
+
+size_t shared_chunk_cache::slot_count() const
+{
+    return static_cast<size_t>(head->nslots);
+}
+
+#ifndef _WIN32
+
+bool shared_chunk_cache::get(const shm_key &key, void *dst, size_t nbytes)
+{
+    shm_lock lock(&head->lock);
+
+    for (uint64_t i = 0; i < head->nslots; i++) {
+        slot &s = slots[i];
+        if (s.full && s.a == key.a && s.b == key.b && s.nbytes == nbytes) {
+            memcpy(dst, data + i * head->slot_bytes, nbytes);
+            s.last_use = ++head->clock;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void shared_chunk_cache::put(const shm_key &key, const void *src, size_t nbytes)
+{
+    if (nbytes > head->slot_bytes) {
+        return;
+    }
+
+    shm_lock lock(&head->lock);
+
+    //an empty slot, else the least recently used one
+    uint64_t victim = 0;
+    for (uint64_t i = 0; i < head->nslots; i++) {
+        slot &s = slots[i];
+        if (s.full && s.a == key.a && s.b == key.b) {
+            //another process was faster
+            s.last_use = ++head->clock;
+            return;
+        }
+
+        if (!s.full) {
+            if (slots[victim].full) {
+                victim = i;
+            }
+        } else if (slots[victim].full && s.last_use < slots[victim].last_use) {
+            victim = i;
+        }
+    }
+
+    slot &s = slots[victim];
+    s.full = 0;
+    memcpy(data + victim * head->slot_bytes, src, nbytes);
+    s.a = key.a;
+    s.b = key.b;
+    s.nbytes = nbytes;
+    s.last_use = ++head->clock;
+    s.full = 1;
+}
+
+#else
+
+bool shared_chunk_cache::get(const shm_key &key, void *dst, size_t nbytes)
+{
+    return false;
+}
+
+void shared_chunk_cache::put(const shm_key &key, const void *src, size_t nbytes)
+{
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef NIX_MX_SHMCACHE_H
+#define NIX_MX_SHMCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+  A cache of plain (decompressed) chunks in POSIX shared memory, for
+  processes on one machine that read the same files, e.g. the workers
+  of a parallel pool. The memory is divided into slots of equal size;
+  a chunk takes one slot and, once all are taken, replaces the least
+  recently used chunk. A process-shared mutex guards the slots, the
+  lookup is a scan of the slot table.
+
+  Chunks are identified by a hash of the identity and version of their
+  file (device, inode, size and modification time, see file_key), the
+  dataset and the position of the chunk; the contents are not read.
+  The memory persists until remove() or a reboot, so later sessions
+  start with what earlier ones have read. POSIX only.
+*/
+
+struct shm_key {
+    uint64_t a;
+    uint64_t b;
+};
+
+class shared_chunk_cache {
+public:
+    //attaches to the cache of that name; it is created with the given
+    //  size and slot size unless another process did so already
+    static std::shared_ptr<shared_chunk_cache> attach(const std::string &name, size_t bytes,
+                                                      size_t slot_bytes);
+
+    //removes the shared memory, attached processes keep their mapping
+    static void remove(const std::string &name);
+
+    //identifies the file at path and its version: device, inode,
+    //  size and time of the last modification, in nanoseconds
+    static std::string file_key(const std::string &path);
+
+    //key of the chunk at offset of the dataset identified by prefix
+    static shm_key make_key(const std::string &prefix, const std::vector<uint64_t> &offset);
+
+    ~shared_chunk_cache();
+
+    shared_chunk_cache(const shared_chunk_cache &other) = delete;
+    shared_chunk_cache &operator=(const shared_chunk_cache &other) = delete;
+
+    //copies the chunk to dst if it is cached with nbytes
+    bool get(const shm_key &key, void *dst, size_t nbytes);
+
+    //caches a chunk, unless it is larger than a slot
+    void put(const shm_key &key, const void *src, size_t nbytes);
+
+    size_t slot_bytes() const;
+
+    size_t slot_count() const;
+
+private:
+    struct header;
+    struct slot;
+
+    shared_chunk_cache(void *base, size_t bytes);
+
+    header *head;
+    slot *slots;
+    char *data;
+    size_t mapped;
+};
+
+#endif
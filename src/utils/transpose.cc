@@ -0,0 +1,205 @@
+#include "transpose.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+//edge length of the square tiles; 32x32 doubles fit into L1
+static const size_t tile_size = 32;
+
+template<typename T>
+static void strided_copy(const T *src, T *dst, size_t n, size_t dst_stride)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i * dst_stride] = src[i];
+    }
+}
+
+/*
+  Axis 0 has the largest stride in the (row-major) source, the last
+  axis is contiguous. In the destination it is the other way round,
+  so both are walked in tiles, which keeps reads and writes within a
+  few cache lines. The axes in between are visited one by one.
+*/
+template<typename T>
+static void transpose_tiled(const T *src, T *dst, const std::vector<size_t> &shape,
+                            const std::vector<size_t> &src_strides,
+                            const std::vector<size_t> &dst_strides)
+{
+    const size_t rank = shape.size();
+    const size_t n_first = shape[0];
+    const size_t n_last = shape[rank - 1];
+    const size_t s_first = src_strides[0];
+    const size_t d_first = dst_strides[0];
+    const size_t d_last = dst_strides[rank - 1];
+
+    std::vector<size_t> idx(rank, 0);
+    size_t src_base = 0;
+    size_t dst_base = 0;
+
+    while (true) {
+        for (size_t i = 0; i < n_first; i += tile_size) {
+            const size_t i_end = std::min(i + tile_size, n_first);
+
+            for (size_t j = 0; j < n_last; j += tile_size) {
+                const size_t j_end = std::min(j + tile_size, n_last);
+
+                for (size_t b = j; b < j_end; b++) {
+                    const T *s = src + src_base + b;
+                    T *d = dst + dst_base + b * d_last;
+
+                    for (size_t a = i; a < i_end; a++) {
+                        d[a * d_first] = s[a * s_first];
+                    }
+                }
+            }
+        }
+
+        //next index of the inner axes
+        size_t k = rank - 2;
+        for (; k > 0; k--) {
+            idx[k]++;
+            src_base += src_strides[k];
+            dst_base += dst_strides[k];
+
+            if (idx[k] < shape[k]) {
+                break;
+            }
+
+            src_base -= idx[k] * src_strides[k];
+            dst_base -= idx[k] * dst_strides[k];
+            idx[k] = 0;
+        }
+
+        if (k == 0) {
+            break;
+        }
+    }
+}
+
+template<typename T>
+static void transpose_dispatch(const void *src, void *dst, const std::vector<size_t> &shape,
+                               const std::vector<size_t> &src_strides,
+                               const std::vector<size_t> &dst_strides)
+{
+    const T *s = static_cast<const T *>(src);
+    T *d = static_cast<T *>(dst);
+
+    if (shape.size() == 1) {
+        strided_copy(s, d, shape[0], dst_strides[0]);
+    } else {
+        transpose_tiled(s, d, shape, src_strides, dst_strides);
+    }
+}
+
+std::vector<size_t> colmajor_strides(const nix::NDSize &extent)
+{
+    std::vector<size_t> strides(extent.size());
+    size_t stride = 1;
+
+    for (size_t i = 0; i < extent.size(); i++) {
+        strides[i] = stride;
+        stride *= static_cast<size_t>(extent[i]);
+    }
+
+    return strides;
+}
+
+bool is_layout_invariant(const nix::NDSize &shape)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < shape.size(); i++) {
+        if (shape[i] != 1) {
+            n++;
+        }
+    }
+
+    return n < 2;
+}
+
+bool is_rowmajor(const nix::NDSize &count, const std::vector<size_t> &strides)
+{
+    size_t stride = 1;
+    for (size_t i = count.size(); i-- > 0;) {
+        if (count[i] != 1 && strides[i] != stride) {
+            return false;
+        }
+        stride *= static_cast<size_t>(count[i]);
+    }
+    return true;
+}
+
+void transpose_copy(const void *src, void *dst, size_t elsize,
+                    const nix::NDSize &shape, const std::vector<size_t> &dst_strides)
+{
+    std::vector<size_t> sq_shape;
+    std::vector<size_t> sq_src;
+    std::vector<size_t> sq_dst;
+    size_t stride = 1;
+
+    for (size_t i = shape.size(); i-- > 0;) {
+        const size_t n = static_cast<size_t>(shape[i]);
+
+        if (n == 0) {
+            return;
+        }
+
+        if (n != 1) {
+            sq_shape.insert(sq_shape.begin(), n);
+            sq_src.insert(sq_src.begin(), stride);
+            sq_dst.insert(sq_dst.begin(), dst_strides[i]);
+        }
+
+        stride *= n;
+    }
+
+    if (sq_shape.empty()) {
+        memcpy(dst, src, elsize);
+        return;
+    }
+
+    if (sq_shape.size() == 1 && sq_dst[0] == 1) {
+        memcpy(dst, src, sq_shape[0] * elsize);
+        return;
+    }
+
+    switch (elsize) {
+    case 1: transpose_dispatch<uint8_t>(src, dst, sq_shape, sq_src, sq_dst); break;
+    case 2: transpose_dispatch<uint16_t>(src, dst, sq_shape, sq_src, sq_dst); break;
+    case 4: transpose_dispatch<uint32_t>(src, dst, sq_shape, sq_src, sq_dst); break;
+    case 8: transpose_dispatch<uint64_t>(src, dst, sq_shape, sq_src, sq_dst); break;
+    default: throw std::invalid_argument("unsupported element size for transposition");
+    }
+}
+
+void extract_block(const void *src, const nix::NDSize &shape, const nix::NDSize &offset,
+                   const nix::NDSize &count, size_t elsize, void *dst)
+{
+    const size_t rank = shape.size();
+    if (count.nelms() == 0) {
+        return;
+    }
+
+    const char *from = static_cast<const char *>(src);
+    char *to = static_cast<char *>(dst);
+    const size_t row = static_cast<size_t>(count[rank - 1]) * elsize;
+    const size_t rows = static_cast<size_t>(count.nelms() / count[rank - 1]);
+
+    nix::NDSize pos(rank, 0);
+    for (size_t r = 0; r < rows; r++) {
+        size_t idx = 0;
+        for (size_t k = 0; k < rank; k++) {
+            idx = idx * shape[k] + offset[k] + pos[k];
+        }
+        memcpy(to + r * row, from + idx * elsize, row);
+
+        //next row: count up the leading axes
+        for (size_t k = rank - 1; k-- > 0;) {
+            if (++pos[k] < count[k]) {
+                break;
+            }
+            pos[k] = 0;
+        }
+    }
+}
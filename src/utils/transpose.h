@@ -0,0 +1,34 @@
+#ifndef NIX_MX_TRANSPOSE_H
+#define NIX_MX_TRANSPOSE_H
+
+#include <nix/NDSize.hpp>
+
+#include <vector>
+#include <cstddef>
+
+// *** row-major (HDF5) to column-major (matlab) conversion ***
+
+//strides (in elements) of a column-major array with the given extent
+std::vector<size_t> colmajor_strides(const nix::NDSize &extent);
+
+//copy the row-major block `src` of the given shape into `dst`,
+//  whose axes are laid out according to dst_strides (in elements).
+//  Singleton axes are dropped and the remaining ones are transposed
+//  in cache sized tiles; elsize must be 1, 2, 4 or 8 bytes.
+void transpose_copy(const void *src, void *dst, size_t elsize,
+                    const nix::NDSize &shape, const std::vector<size_t> &dst_strides);
+
+//true if strides (in elements) lay a block of the given count out in
+//  row-major order, i.e. it can be copied without a transpose
+bool is_rowmajor(const nix::NDSize &count, const std::vector<size_t> &strides);
+
+//copy the block at offset with the given count out of the row-major
+//  array `src` of the given shape into the row-major array `dst`
+void extract_block(const void *src, const nix::NDSize &shape, const nix::NDSize &offset,
+                   const nix::NDSize &count, size_t elsize, void *dst);
+
+//true if a block of the given shape has the same memory layout in
+//  row- and column-major order, i.e. it has at most one axis > 1
+bool is_layout_invariant(const nix::NDSize &shape);
+
+#endif
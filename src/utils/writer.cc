@@ -0,0 +1,121 @@
+#include "writer.h"
+#include "h5select.h"
+
+#include <cstring>
+#include <stdexcept>
+
+write_queue::write_queue(h5_id dset, size_t max_bytes)
+    : dset(std::move(dset)), max_bytes(max_bytes), pending_bytes(0), stopping(false)
+{
+    worker = std::thread(&write_queue::run, this);
+}
+
+write_queue::~write_queue()
+{
+    try {
+        wait();
+    } catch (const std::exception &) {
+        //nobody is left to report to
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+
+    cv_items.notify_all();
+    worker.join();
+}
+
+void write_queue::check()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (!error.empty()) {
+        std::string msg = "asynchronous write failed: " + error;
+        error.clear();
+        throw std::runtime_error(msg);
+    }
+}
+
+void write_queue::push(nix::DataType dtype, const void *data,
+                       const nix::NDSize &offset, const nix::NDSize &count)
+{
+    check();
+
+    const size_t nbytes = static_cast<size_t>(count.nelms()) * nix::data_type_to_size(dtype);
+
+    item it;
+    it.memtype = h5_mem_type(dset.get(), dtype);
+    it.data.resize(nbytes);
+    memcpy(it.data.data(), data, nbytes);
+    it.offset.assign(offset.begin(), offset.end());
+    it.count.assign(count.begin(), count.end());
+
+    //wait for room, a single large write is let through alone
+    h5_unlocked([&] {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_done.wait(lock, [&] {
+            return items.empty() || pending_bytes + nbytes <= max_bytes;
+        });
+
+        pending_bytes += nbytes;
+        items.push_back(std::move(it));
+    });
+
+    cv_items.notify_one();
+}
+
+void write_queue::wait()
+{
+    h5_unlocked([this] {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_done.wait(lock, [this] { return items.empty(); });
+    });
+
+    check();
+}
+
+void write_queue::flush()
+{
+    wait();
+    h5_flush_file(dset.get());
+}
+
+void write_queue::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+        cv_items.wait(lock, [this] { return stopping || !items.empty(); });
+
+        if (items.empty()) {
+            return;
+        }
+
+        //elements of a deque stay in place while others are added
+        const item &it = items.front();
+        lock.unlock();
+
+        std::string failure;
+        {
+            std::lock_guard<std::timed_mutex> h5(h5_mutex());
+
+            try {
+                h5_write_hyperslab(dset.get(), it.memtype.get(), it.offset, it.count, it.data.data());
+            } catch (const std::exception &e) {
+                failure = e.what();
+            }
+        }
+
+        lock.lock();
+
+        if (!failure.empty() && error.empty()) {
+            error = failure;
+        }
+
+        pending_bytes -= it.data.size();
+        items.pop_front();
+        cv_done.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef NIX_MX_WRITER_H
+#define NIX_MX_WRITER_H
+
+#include "h5util.h"
+
+#include <nix/NDSize.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+  Writes data to a dataset in a worker thread. push() copies the
+  data and returns, unless more than max_bytes are waiting already.
+  The worker takes h5_mutex for every write, i.e. writes in between
+  commands; errors are reported by the next push() or wait().
+
+  All members must be called with h5_mutex held (as every command
+  does); positions are in file order and data is row-major.
+*/
+class write_queue {
+public:
+    write_queue(h5_id dset, size_t max_bytes);
+
+    //waits for the pending writes, their errors are lost
+    ~write_queue();
+
+    write_queue(const write_queue &other) = delete;
+    write_queue &operator=(const write_queue &other) = delete;
+
+    //count elements of dtype from data go to the block at offset
+    void push(nix::DataType dtype, const void *data,
+              const nix::NDSize &offset, const nix::NDSize &count);
+
+    //blocks until everything has been written
+    void wait();
+
+    //wait() and flush the file to disk
+    void flush();
+
+private:
+    struct item {
+        h5_id memtype;
+        std::vector<char> data;
+        std::vector<hsize_t> offset;
+        std::vector<hsize_t> count;
+    };
+
+    void run();
+
+    //throws the error of a failed write once
+    void check();
+
+    h5_id dset;
+    size_t max_bytes;
+
+    std::mutex mtx;
+    std::condition_variable cv_items;
+    std::condition_variable cv_done;
+    std::deque<item> items;
+    size_t pending_bytes;
+    bool stopping;
+    std::string error;
+
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,531 @@
+#include "zonemap.h"
+#include "h5select.h"
+#include "calibrate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+const char *zone_map_name = "nix_mx_zones";
+
+static const char *zone_extent_attr = "zone_extent";
+
+//elements of a zone of a dataset without chunks
+static const size_t zone_elements = 1 << 16;
+
+//zones per chunk of the zone map
+static const double zones_per_chunk = 4096;
+
+static const double unknown = std::numeric_limits<double>::quiet_NaN();
+static const double infinity = std::numeric_limits<double>::infinity();
+
+static nix::NDSize grid_of(const nix::NDSize &extent, const nix::NDSize &zone)
+{
+    nix::NDSize grid(extent.size());
+    for (size_t k = 0; k < extent.size(); k++) {
+        grid[k] = (extent[k] + zone[k] - 1) / zone[k];
+    }
+    return grid;
+}
+
+static size_t linear(const nix::NDSize &pos, const nix::NDSize &shape)
+{
+    size_t idx = 0;
+    for (size_t k = 0; k < shape.size(); k++) {
+        idx = idx * static_cast<size_t>(shape[k]) + static_cast<size_t>(pos[k]);
+    }
+    return idx;
+}
+
+//next position within shape in row-major order, false after the last
+static bool advance(nix::NDSize &pos, const nix::NDSize &shape)
+{
+    for (size_t k = shape.size(); k-- > 0;) {
+        if (++pos[k] < shape[k]) {
+            return true;
+        }
+        pos[k] = 0;
+    }
+    return false;
+}
+
+static bool is_writable(hid_t obj)
+{
+    h5_id file(H5Iget_file_id(obj));
+    unsigned int intent = 0;
+    return H5Fget_intent(file.get(), &intent) >= 0 && (intent & H5F_ACC_RDWR) != 0;
+}
+
+// *** the zone map dataset ***
+
+static nix::NDSize read_zone_extent(hid_t zds)
+{
+    h5_id attr(H5Aopen(zds, zone_extent_attr, H5P_DEFAULT));
+    h5_id space(H5Aget_space(attr.get()));
+    const hssize_t n = H5Sget_simple_extent_npoints(space.get());
+
+    std::vector<uint64_t> zone(n > 0 ? static_cast<size_t>(n) : 0);
+    if (!attr.valid() || n <= 0 || H5Aread(attr.get(), H5T_NATIVE_UINT64, zone.data()) < 0) {
+        throw std::runtime_error("the zone map has no valid zone extent");
+    }
+
+    nix::NDSize res(zone.size());
+    for (size_t k = 0; k < zone.size(); k++) {
+        res[k] = zone[k];
+    }
+    return res;
+}
+
+//the grid of the zone map, without the axis of the bounds
+static nix::NDSize stored_grid(hid_t zds)
+{
+    h5_id space(H5Dget_space(zds));
+    const int rank = H5Sget_simple_extent_ndims(space.get());
+    std::vector<hsize_t> dims(rank > 0 ? static_cast<size_t>(rank) : 0);
+    H5Sget_simple_extent_dims(space.get(), dims.data(), nullptr);
+
+    nix::NDSize grid(dims.size() - 1);
+    for (size_t k = 0; k + 1 < dims.size(); k++) {
+        grid[k] = dims[k];
+    }
+    return grid;
+}
+
+static void regrid(hid_t zds, const nix::NDSize &grid)
+{
+    if (stored_grid(zds) == grid) {
+        return;
+    }
+
+    std::vector<hsize_t> dims(grid.begin(), grid.end());
+    dims.push_back(2);
+    if (H5Dset_extent(zds, dims.data()) < 0) {
+        throw std::runtime_error("could not resize the zone map");
+    }
+}
+
+static h5_id create_zone_map(hid_t group, const nix::NDSize &grid, const nix::NDSize &zone)
+{
+    const size_t rank = grid.size();
+    std::vector<hsize_t> dims(grid.begin(), grid.end()), maxdims(rank + 1, H5S_UNLIMITED), chunk(rank + 1);
+    dims.push_back(2);
+    maxdims[rank] = 2;
+
+    //about zones_per_chunk zones per chunk, equally along all axes
+    const hsize_t side = std::max<hsize_t>(1, static_cast<hsize_t>(std::pow(zones_per_chunk, 1.0 / rank)));
+    std::fill(chunk.begin(), chunk.end(), side);
+    chunk[rank] = 2;
+
+    h5_id space(H5Screate_simple(static_cast<int>(rank + 1), dims.data(), maxdims.data()));
+    h5_id dcpl(H5Pcreate(H5P_DATASET_CREATE));
+    H5Pset_chunk(dcpl.get(), static_cast<int>(rank + 1), chunk.data());
+    H5Pset_fill_value(dcpl.get(), H5T_NATIVE_DOUBLE, &unknown);
+
+    h5_id zds(H5Dcreate2(group, zone_map_name, H5T_IEEE_F64LE, space.get(), H5P_DEFAULT,
+                         dcpl.get(), H5P_DEFAULT));
+
+    std::vector<uint64_t> zext(zone.begin(), zone.end());
+    const hsize_t n = zext.size();
+    h5_id aspace(H5Screate_simple(1, &n, nullptr));
+    h5_id attr(H5Acreate2(zds.get(), zone_extent_attr, H5T_STD_U64LE, aspace.get(), H5P_DEFAULT, H5P_DEFAULT));
+
+    if (!zds.valid() || !attr.valid() || H5Awrite(attr.get(), H5T_NATIVE_UINT64, zext.data()) < 0) {
+        throw std::runtime_error("could not create the zone map");
+    }
+
+    return zds;
+}
+
+//the bounds of the zones [zoff, zoff + zcnt) of grid; what is not stored is unknown
+static std::vector<double> read_bounds(hid_t zds, const nix::NDSize &zoff, const nix::NDSize &zcnt)
+{
+    std::vector<double> bounds(2 * static_cast<size_t>(zcnt.nelms()), unknown);
+    const nix::NDSize stored = stored_grid(zds);
+
+    //the part of the block that is stored
+    nix::NDSize count = zcnt;
+    for (size_t k = 0; k < zcnt.size(); k++) {
+        count[k] = zoff[k] < stored[k] ? std::min(zcnt[k], stored[k] - zoff[k]) : 0;
+    }
+
+    if (count.nelms() == 0) {
+        return bounds;
+    }
+
+    std::vector<hsize_t> h_offset(zoff.begin(), zoff.end()), h_count(count.begin(), count.end());
+    h_offset.push_back(0);
+    h_count.push_back(2);
+
+    if (count == zcnt) {
+        h5_read_hyperslab(zds, H5T_NATIVE_DOUBLE, h_offset, h_count, bounds.data());
+        return bounds;
+    }
+
+    std::vector<double> part(2 * static_cast<size_t>(count.nelms()));
+    h5_read_hyperslab(zds, H5T_NATIVE_DOUBLE, h_offset, h_count, part.data());
+
+    nix::NDSize pos(count.size(), 0);
+    size_t i = 0;
+    do {
+        const size_t z = linear(pos, zcnt);
+        bounds[2 * z] = part[2 * i];
+        bounds[2 * z + 1] = part[2 * i + 1];
+        i++;
+    } while (advance(pos, count));
+
+    return bounds;
+}
+
+static void write_bounds(hid_t zds, const nix::NDSize &zoff, const nix::NDSize &zcnt,
+                         const std::vector<double> &bounds)
+{
+    std::vector<hsize_t> h_offset(zoff.begin(), zoff.end()), h_count(zcnt.begin(), zcnt.end());
+    h_offset.push_back(0);
+    h_count.push_back(2);
+    h5_write_hyperslab(zds, H5T_NATIVE_DOUBLE, h_offset, h_count, bounds.data());
+}
+
+// *** bounds of blocks ***
+
+/*
+  Minimum and maximum per zone of the row-major block data at offset,
+  for the zones [zoff, zoff + zcnt) it touches; NaN is left out, seen
+  tells whether a zone had any other value. A row of the block is cut
+  into the runs that lie in one zone.
+*/
+template<typename T>
+static void block_bounds(const T *data, const nix::NDSize &offset, const nix::NDSize &count,
+                         const nix::NDSize &zone, const nix::NDSize &zoff, const nix::NDSize &zcnt,
+                         T *lo, T *hi, char *seen)
+{
+    const size_t rank = count.size();
+    const size_t last = rank - 1;
+    const size_t len = static_cast<size_t>(count[last]);
+
+    nix::NDSize lead = count, pos(rank, 0), zpos(rank, 0);
+    lead[last] = 1;
+
+    do {
+        for (size_t k = 0; k < last; k++) {
+            zpos[k] = (offset[k] + pos[k]) / zone[k] - zoff[k];
+        }
+
+        const T *row = data + linear(pos, lead) * len;
+
+        for (size_t j = 0; j < len;) {
+            const size_t global = static_cast<size_t>(offset[last]) + j;
+            const size_t z = global / static_cast<size_t>(zone[last]);
+            const size_t end = std::min(len, (z + 1) * static_cast<size_t>(zone[last]) - static_cast<size_t>(offset[last]));
+
+            zpos[last] = z - zoff[last];
+            const size_t idx = linear(zpos, zcnt);
+
+            T l = lo[idx], h = hi[idx];
+            bool any = false;
+            for (size_t i = j; i < end; i++) {
+                const T v = row[i];
+                l = v < l ? v : l;
+                h = v > h ? v : h;
+                any = any || v == v;
+            }
+
+            lo[idx] = l;
+            hi[idx] = h;
+            seen[idx] = seen[idx] || any;
+            j = end;
+        }
+    } while (advance(pos, lead));
+}
+
+template<typename T>
+static void typed_bounds(const void *data, const nix::NDSize &offset, const nix::NDSize &count,
+                         const nix::NDSize &zone, const nix::NDSize &zoff, const nix::NDSize &zcnt,
+                         std::vector<char> &lo, std::vector<char> &hi, std::vector<char> &seen)
+{
+    const size_t n = static_cast<size_t>(zcnt.nelms());
+    std::vector<T> l(n, std::numeric_limits<T>::max()), h(n, std::numeric_limits<T>::lowest());
+
+    block_bounds(static_cast<const T *>(data), offset, count, zone, zoff, zcnt, l.data(), h.data(), seen.data());
+
+    memcpy(lo.data(), l.data(), n * sizeof(T));
+    memcpy(hi.data(), h.data(), n * sizeof(T));
+}
+
+//bounds per zone as doubles, (inf, -inf) for zones without values;
+// the values of dtype are converted to the stored type first, like
+// HDF5 converts them when they are written
+static std::vector<double> data_bounds(hid_t dset, nix::DataType stored, nix::DataType dtype, const void *data,
+                                       const nix::NDSize &offset, const nix::NDSize &count,
+                                       const nix::NDSize &zone, const nix::NDSize &zoff, const nix::NDSize &zcnt)
+{
+    const size_t n = static_cast<size_t>(zcnt.nelms());
+
+    //room for the values in either type
+    std::vector<char> lo(n * 8), hi(n * 8), seen(n, 0);
+
+    switch (dtype) {
+    case nix::DataType::Float: typed_bounds<float>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::Double: typed_bounds<double>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::Int8: typed_bounds<int8_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::Int16: typed_bounds<int16_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::Int32: typed_bounds<int32_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::Int64: typed_bounds<int64_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::UInt8: typed_bounds<uint8_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::UInt16: typed_bounds<uint16_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::UInt32: typed_bounds<uint32_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    case nix::DataType::UInt64: typed_bounds<uint64_t>(data, offset, count, zone, zoff, zcnt, lo, hi, seen); break;
+    default: throw std::domain_error("zone maps require numeric data");
+    }
+
+    //conversions are monotonic, so the converted bounds bound the
+    // converted values
+    if (stored != dtype) {
+        h5_id src = h5_mem_type(dset, dtype);
+        h5_id dst = h5_mem_type(dset, stored);
+        if (H5Tconvert(src.get(), dst.get(), n, lo.data(), nullptr, H5P_DEFAULT) < 0 ||
+            H5Tconvert(src.get(), dst.get(), n, hi.data(), nullptr, H5P_DEFAULT) < 0) {
+            throw std::runtime_error("could not convert the bounds of the written data");
+        }
+    }
+
+    std::vector<double> l(n), h(n), bounds(2 * n);
+    apply_polynomial(polynomial(), stored, lo.data(), n, false, l.data());
+    apply_polynomial(polynomial(), stored, hi.data(), n, false, h.data());
+
+    for (size_t z = 0; z < n; z++) {
+        bounds[2 * z] = seen[z] ? l[z] : infinity;
+        bounds[2 * z + 1] = seen[z] ? h[z] : -infinity;
+    }
+
+    return bounds;
+}
+
+// *** building and updating ***
+
+static nix::NDSize zone_extent_for(hid_t dset, const nix::NDSize &extent)
+{
+    nix::NDSize chunks = h5_chunk_extent(dset);
+    if (chunks.size() == extent.size()) {
+        return chunks;
+    }
+
+    //rows of about zone_elements values
+    nix::NDSize zone = extent;
+    size_t row = 1;
+    for (size_t k = 1; k < extent.size(); k++) {
+        zone[k] = std::max<nix::ndsize_t>(1, extent[k]);
+        row *= static_cast<size_t>(zone[k]);
+    }
+    zone[0] = std::max<size_t>(1, zone_elements / row);
+    return zone;
+}
+
+bool h5_has_zone_map(hid_t group)
+{
+    return H5Lexists(group, zone_map_name, H5P_DEFAULT) > 0;
+}
+
+void h5_drop_zone_map(hid_t group)
+{
+    if (h5_has_zone_map(group) && H5Ldelete(group, zone_map_name, H5P_DEFAULT) < 0) {
+        throw std::runtime_error("could not remove the zone map");
+    }
+}
+
+void h5_build_zone_map(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent)
+{
+    if (extent.size() == 0) {
+        throw std::invalid_argument("zone maps require data with at least one dimension");
+    }
+
+    const nix::NDSize zone = zone_extent_for(dset, extent);
+    const nix::NDSize grid = grid_of(extent, zone);
+
+    h5_drop_zone_map(group);
+    h5_id zds = create_zone_map(group, grid, zone);
+
+    if (extent.nelms() == 0) {
+        return;
+    }
+
+    //a slab of zones along the first axis at a time
+    h5_id memtype = h5_mem_type(dset, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+    nix::NDSize zoff(grid.size(), 0), zcnt = grid;
+    zcnt[0] = 1;
+
+    std::vector<char> raw;
+    for (nix::ndsize_t z = 0; z < grid[0]; z++) {
+        nix::NDSize offset(extent.size(), 0), count = extent;
+        offset[0] = z * zone[0];
+        count[0] = std::min(zone[0], extent[0] - offset[0]);
+        zoff[0] = z;
+
+        std::vector<hsize_t> h_offset(offset.begin(), offset.end()), h_count(count.begin(), count.end());
+        raw.resize(static_cast<size_t>(count.nelms()) * elsize);
+        h5_read_hyperslab(dset, memtype.get(), h_offset, h_count, raw.data());
+
+        std::vector<double> bounds = data_bounds(dset, dtype, dtype, raw.data(), offset, count, zone, zoff, zcnt);
+        write_bounds(zds.get(), zoff, zcnt, bounds);
+    }
+}
+
+void h5_update_zones(hid_t group, hid_t dset, nix::DataType stored, nix::DataType dtype, const void *data,
+                     const nix::NDSize &offset, const nix::NDSize &count,
+                     const nix::NDSize &previous, const nix::NDSize &extent)
+{
+    h5_id zds(H5Dopen2(group, zone_map_name, H5P_DEFAULT));
+    if (!zds.valid()) {
+        throw std::runtime_error("could not open the zone map");
+    }
+
+    const size_t rank = extent.size();
+    const nix::NDSize zone = read_zone_extent(zds.get());
+    if (zone.size() != rank) {
+        throw std::runtime_error("the zone map does not match the rank of the data");
+    }
+
+    regrid(zds.get(), grid_of(extent, zone));
+
+    if (count.nelms() == 0) {
+        return;
+    }
+
+    //the zones the block touches
+    nix::NDSize zoff(rank), zcnt(rank);
+    for (size_t k = 0; k < rank; k++) {
+        zoff[k] = offset[k] / zone[k];
+        zcnt[k] = (offset[k] + count[k] - 1) / zone[k] - zoff[k] + 1;
+    }
+
+    std::vector<double> bounds = read_bounds(zds.get(), zoff, zcnt);
+    std::vector<double> written = data_bounds(dset, stored, dtype, data, offset, count, zone, zoff, zcnt);
+
+    nix::NDSize pos(rank, 0);
+    size_t z = 0;
+    do {
+        //the zone within the data, and whether the block replaced all
+        // its values or it had none before
+        bool covered = true, fresh = previous.size() != rank;
+        for (size_t k = 0; k < rank; k++) {
+            const nix::ndsize_t start = (zoff[k] + pos[k]) * zone[k];
+            const nix::ndsize_t end = std::min(start + zone[k], extent[k]);
+            covered = covered && offset[k] <= start && end <= offset[k] + count[k];
+            fresh = fresh || start >= previous[k];
+        }
+
+        double &lo = bounds[2 * z], &hi = bounds[2 * z + 1];
+        if (covered || fresh) {
+            lo = written[2 * z];
+            hi = written[2 * z + 1];
+        } else if (!std::isnan(lo)) {
+            lo = std::min(lo, written[2 * z]);
+            hi = std::max(hi, written[2 * z + 1]);
+        }
+        z++;
+    } while (advance(pos, zcnt));
+
+    write_bounds(zds.get(), zoff, zcnt, bounds);
+}
+
+// *** searching ***
+
+std::vector<double> h5_find_range(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                                  double lo, double hi, const std::vector<size_t> &strides)
+{
+    const size_t rank = extent.size();
+    std::vector<double> res;
+    if (extent.nelms() == 0 || !(lo <= hi)) {
+        return res;
+    }
+
+    //without a zone map all zones are unknown
+    h5_id zds;
+    nix::NDSize zone = zone_extent_for(dset, extent);
+    if (h5_has_zone_map(group)) {
+        zds = h5_id(H5Dopen2(group, zone_map_name, H5P_DEFAULT));
+        zone = read_zone_extent(zds.get());
+        if (zone.size() != rank) {
+            throw std::runtime_error("the zone map does not match the rank of the data");
+        }
+    }
+
+    const nix::NDSize grid = grid_of(extent, zone);
+    std::vector<double> bounds = zds.valid() ? read_bounds(zds.get(), nix::NDSize(rank, 0), grid) :
+        std::vector<double>(2 * static_cast<size_t>(grid.nelms()), unknown);
+
+    h5_id memtype = h5_mem_type(dset, dtype);
+    const size_t elsize = nix::data_type_to_size(dtype);
+    const size_t last = rank - 1;
+
+    std::vector<char> raw;
+    std::vector<double> values;
+    bool learned = false;
+
+    nix::NDSize zpos(rank, 0);
+    size_t z = 0;
+    do {
+        double &zlo = bounds[2 * z], &zhi = bounds[2 * z + 1];
+        const bool known = !std::isnan(zlo) && !std::isnan(zhi);
+        z++;
+
+        if (known && (zlo > hi || zhi < lo)) {
+            continue;
+        }
+
+        nix::NDSize offset(rank), count(rank);
+        for (size_t k = 0; k < rank; k++) {
+            offset[k] = zpos[k] * zone[k];
+            count[k] = std::min(zone[k], extent[k] - offset[k]);
+        }
+
+        const size_t n = static_cast<size_t>(count.nelms());
+        std::vector<hsize_t> h_offset(offset.begin(), offset.end()), h_count(count.begin(), count.end());
+        raw.resize(n * elsize);
+        values.resize(n);
+        h5_read_hyperslab(dset, memtype.get(), h_offset, h_count, raw.data());
+        apply_polynomial(polynomial(), dtype, raw.data(), n, false, values.data());
+
+        if (!known) {
+            double l = infinity, h = -infinity;
+            for (size_t i = 0; i < n; i++) {
+                l = values[i] < l ? values[i] : l;
+                h = values[i] > h ? values[i] : h;
+            }
+            zlo = l;
+            zhi = h;
+            learned = true;
+        }
+
+        //rows along the last axis
+        const size_t len = static_cast<size_t>(count[last]);
+        nix::NDSize lead = count, pos(rank, 0);
+        lead[last] = 1;
+
+        const double *v = values.data();
+        do {
+            size_t base = 1;
+            for (size_t k = 0; k < rank; k++) {
+                base += static_cast<size_t>(offset[k] + pos[k]) * strides[k];
+            }
+
+            for (size_t j = 0; j < len; j++) {
+                if (v[j] >= lo && v[j] <= hi) {
+                    res.push_back(static_cast<double>(base + j * strides[last]));
+                }
+            }
+            v += len;
+        } while (advance(pos, lead));
+    } while (advance(zpos, grid));
+
+    if (learned && zds.valid() && is_writable(dset)) {
+        regrid(zds.get(), grid);
+        write_bounds(zds.get(), nix::NDSize(rank, 0), grid, bounds);
+    }
+
+    std::sort(res.begin(), res.end());
+    return res;
+}
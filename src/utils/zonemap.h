@@ -0,0 +1,50 @@
+#ifndef NIX_MX_ZONEMAP_H
+#define NIX_MX_ZONEMAP_H
+
+#include "h5util.h"
+
+#include <hdf5.h>
+#include <nix/DataType.hpp>
+#include <nix/NDSize.hpp>
+
+#include <vector>
+
+/*
+  Zone maps: the minimum and maximum of every chunk of a dataset (of
+  every block of rows if it has no chunks), stored as the dataset
+  zone_map_name next to it in the group of the DataArray. Searches
+  for values in a range read only the zones whose bounds overlap it.
+
+  The map is laid out like the grid of the zones, in file order,
+  with a trailing axis of 2 for (min, max). NaN bounds are unknown,
+  i.e. the zone has to be read; a zone without values (only NaN or
+  not written yet) has the bounds (inf, -inf). Writes widen the
+  bounds of the zones they touch, so bounds may be loose but always
+  hold the values.
+*/
+
+extern const char *zone_map_name;
+
+bool h5_has_zone_map(hid_t group);
+
+//reads the dataset dset of the numeric type dtype within extent and
+//  stores its zone map, replacing an existing one
+void h5_build_zone_map(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent);
+
+void h5_drop_zone_map(hid_t group);
+
+//merges the bounds of the row-major block of dtype at offset, which
+//  has been written to dset of type stored, into the zone map; the
+//  data extended from previous to extent. Zones the block covers, or
+//  without values before, take the bounds of the block.
+void h5_update_zones(hid_t group, hid_t dset, nix::DataType stored, nix::DataType dtype, const void *data,
+                     const nix::NDSize &offset, const nix::NDSize &count,
+                     const nix::NDSize &previous, const nix::NDSize &extent);
+
+//the linear indices sum_k (pos(k) * strides(k)) + 1 of the values in
+//  [lo, hi] within extent, ascending. Zones whose bounds are unknown
+//  are read as well; their bounds are stored if the file is writable.
+std::vector<double> h5_find_range(hid_t group, hid_t dset, nix::DataType dtype, const nix::NDSize &extent,
+                                  double lo, double hi, const std::vector<size_t> &strides);
+
+#endif
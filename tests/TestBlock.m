@@ -6,6 +6,7 @@ function funcs = TestBlock
     funcs{end+1} = @test_attrs;
     funcs{end+1} = @test_create_data_array;
     funcs{end+1} = @test_create_data_array_from_data;
+    funcs{end+1} = @test_create_data_array_layout;
     funcs{end+1} = @test_delete_data_array;
     funcs{end+1} = @test_create_tag;
     funcs{end+1} = @test_delete_tag;
@@ -85,6 +86,39 @@ function [] = test_create_data_array_from_data( varargin )
     assert(~isempty(b.dataArrays));
 end
 
+%% Test: Create Data Array with chunks and compression
+function [] = test_create_data_array_layout( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('arraytest', 'nixblock');
+
+    opts = struct('chunks', [4 256], 'deflate', 4, 'shuffle', true, 'fill', -1);
+    d1 = b.create_data_array('foo', 'bar', 'double', [16 1000], opts);
+
+    assert(isequal(d1.info.chunks, [4 256]));
+    assert(d1.info.deflate == 4);
+    assert(d1.info.shuffle);
+    assert(d1.info.fill == -1);
+    assert(all(all(d1.read_all() == -1)));
+
+    data = reshape(1:16000, 16, 1000);
+    d1.write_all(data);
+    assert(isequal(d1.read_all(), data));
+
+    opts = struct('storage', 'column-major', 'chunks', [16 100]);
+    d2 = b.create_data_array_from_data('colmajor', 'bar', data, opts);
+    assert(isequal(d2.info.chunks, [16 100]));
+    assert(d2.info.deflate == 0);
+    assert(isequal(d2.read_all(), data));
+
+    try
+        b.create_data_array('bad', 'bar', 'double', [16 1000], struct('chunks', 4));
+        error('chunks of the wrong rank must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+    assert(isempty(b.data_array('bad')));
+end
+
 %% Test: delete dataArray by entity and id
 function [] = test_delete_data_array( varargin )
     f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
@@ -9,6 +9,23 @@ function funcs = TestDataArray
     funcs{end+1} = @test_open_metadata;
     funcs{end+1} = @test_list_sources;
     funcs{end+1} = @test_set_data;
+    funcs{end+1} = @test_read_write_range;
+    funcs{end+1} = @test_read_nd;
+    funcs{end+1} = @test_read_into;
+    funcs{end+1} = @test_read_compressed;
+    funcs{end+1} = @test_read_contiguous;
+    funcs{end+1} = @test_read_calibrated;
+    funcs{end+1} = @test_write_quantized;
+    funcs{end+1} = @test_reduce;
+    funcs{end+1} = @test_find_range;
+    funcs{end+1} = @test_read_envelope;
+    funcs{end+1} = @test_write_compressed;
+    funcs{end+1} = @test_read_indexed;
+    funcs{end+1} = @test_cursor;
+    funcs{end+1} = @test_prefetch;
+    funcs{end+1} = @test_async_write;
+    funcs{end+1} = @test_column_major;
+    funcs{end+1} = @test_append_data;
     funcs{end+1} = @test_add_source;
     funcs{end+1} = @test_remove_source;
     funcs{end+1} = @test_dimensions;
@@ -111,6 +128,532 @@ function [] = test_set_data( varargin )
     assert(isequal(d1.read_all(), data));
 end
 
+%% Test: Read and write a hyperslab of a DataArray
+function [] = test_read_write_range( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('rangetest', 'nixblock');
+
+    data = reshape(1:24, 4, 6);
+    d1 = b.create_data_array('foo', 'bar', 'double', [4 6]);
+    d1.write_range(data, [1 1]);
+
+    assert(isequal(d1.read_range([1 1], [4 6]), data));
+    assert(isequal(d1.read_range([2 3], [2 3]), data(2:3, 3:5)));
+    assert(isequal(d1.read_range([4 6], [1 1]), data(4, 6)));
+
+    d1.write_range([-1 -2; -3 -4], [3 5]);
+    data(3:4, 5:6) = [-1 -2; -3 -4];
+    assert(isequal(d1.read_all(), data));
+
+    d1.write_range([7 8 9], [1 2]);
+    data(1, 2:4) = [7 8 9];
+    assert(isequal(d1.read_range([1 1], [4 6]), data));
+
+    try
+        d1.read_range([3 1], [4 6]);
+    catch
+        return;
+    end
+    error('read outside of the extent of the DataArray should fail');
+end
+
+%% Test: N-d data is returned in the shape of the DataArray
+function [] = test_read_nd( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('ndtest', 'nixblock');
+
+    data = reshape(1:120, 4, 5, 6);
+    d1 = b.create_data_array('nd', 'bar', 'double', [4 5 6]);
+    d1.write_range(data, [1 1 1]);
+    assert(isequal(d1.read_all(), data));
+    assert(isequal(d1.read_range([2 1 3], [2 5 3]), data(2:3, :, 3:5)));
+
+    single_row = reshape(1:6, 1, 2, 3);
+    d2 = b.create_data_array('singleton', 'bar', 'int32', [1 2 3]);
+    d2.write_range(int32(single_row), [1 1 1]);
+    assert(isequal(size(d2.read_all()), [1 2 3]));
+    assert(isequal(d2.read_all(), int32(single_row)));
+
+    d3 = b.create_data_array('vector', 'bar', 'double', [7]);
+    d3.write_range(1:7, 1);
+    assert(isequal(d3.read_all(), 1:7));
+end
+
+%% Test: Read all of a compressed array
+function [] = test_read_compressed( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('compressedtest', 'nixblock');
+
+    % edge chunks, partially written
+    opts = struct('chunks', [16 100], 'deflate', 6, 'shuffle', true, 'fill', -1);
+    d1 = b.create_data_array('rowmajor', 'bar', 'double', [40 450], opts);
+    data = -ones(40, 450);
+    data(1:20, 1:300) = reshape(1:6000, 20, 300);
+    d1.write_range(data(1:20, 1:300), [1 1]);
+    assert(isequal(d1.read_all(), data));
+
+    opts = struct('storage', 'column-major', 'chunks', [7 5 3], 'deflate', 1);
+    data = int16(reshape(1:2310, 11, 21, 10));
+    d2 = b.create_data_array_from_data('colmajor', 'bar', data, opts);
+    assert(isequal(d2.read_all(), data));
+    assert(isequal(d2.read_range([2 3 4], [5 6 7]), data(2:6, 3:8, 4:10)));
+end
+
+%% Test: Read contiguous data from a mapping of the file
+function [] = test_read_contiguous( varargin )
+    fname = fullfile(pwd, 'tests', 'testRW.h5');
+    f = nix.File(fname, nix.FileMode.Overwrite);
+    b = f.createBlock('contiguoustest', 'nixblock');
+
+    opts = struct('contiguous', true);
+    data = reshape(1:6000, 40, 150);
+    b.create_data_array_from_data('rowmajor', 'bar', data, opts);
+
+    opts = struct('contiguous', true, 'storage', 'column-major');
+    data3 = int16(reshape(1:2310, 11, 21, 10));
+    b.create_data_array_from_data('colmajor', 'bar', data3, opts);
+
+    try
+        b.create_data_array('chunked', 'bar', 'double', [4 4], ...
+            struct('contiguous', true, 'deflate', 1));
+        error('creating must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+    clear b f;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly);
+    d1 = f.blocks{1}.data_array('rowmajor');
+    d2 = f.blocks{1}.data_array('colmajor');
+    assert(isempty(d1.info.chunks));
+
+    assert(isequal(d1.read_all(), data));
+    assert(isequal(d1.read_range([3 20], [30 100]), data(3:32, 20:119)));
+    assert(isequal(d1.read_range([40 1], [1 150]), data(40, :)));
+    assert(isequal(d2.read_all(), data3));
+    assert(isequal(d2.read_range([2 3 4], [5 6 7]), data3(2:6, 3:8, 4:10)));
+end
+
+%% Test: Read data with the polynomial and origin applied
+function [] = test_read_calibrated( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('calibratedtest', 'nixblock');
+
+    raw = int16(reshape(-3000:2999, 40, 150));
+    d1 = b.create_data_array_from_data('rowmajor', 'bar', raw);
+    opts = struct('storage', 'column-major');
+    d2 = b.create_data_array_from_data('colmajor', 'bar', raw, opts);
+
+    % without a polynomial the values are converted
+    assert(isequal(d1.read_calibrated(), double(raw)));
+    assert(isequal(d2.read_calibrated('single'), single(raw)));
+
+    x = double(raw) - 2.5;
+    expected = 0.5 + 2e-3 * x + 1e-6 * x.^2;
+    for d = {d1, d2}
+        da = d{1};
+        da.polynom_coefficients = [0.5 2e-3 1e-6];
+        da.expansionOrigin = 2.5;
+        assert(da.expansionOrigin == 2.5);
+
+        data = da.read_calibrated();
+        assert(isa(data, 'double'));
+        assert(max(abs(data(:) - expected(:))) < 1e-12);
+
+        data = da.read_calibrated('single', [3 20], [30 100]);
+        assert(isa(data, 'single'));
+        part = expected(3:32, 20:119);
+        assert(max(abs(double(data(:)) - part(:))) < 1e-5);
+    end;
+end
+
+%% Test: Store floating point data as scaled integers
+function [] = test_write_quantized( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('quantizedtest', 'nixblock');
+
+    data = sin(reshape(1:6000, 40, 150) / 100) * 3 + 1;
+    opts = struct('chunks', [16 32], 'deflate', 1);
+    d1 = b.create_data_array('rowmajor', 'bar', 'int16', [40 150], opts);
+    assert(d1.write_quantized(data, 1e-3, 1) == 0);
+    assert(isequal(d1.polynom_coefficients, [1 1e-3]));
+    assert(isequal(d1.read_all(), int16((data - 1) / 1e-3)));
+    err = d1.read_calibrated() - data;
+    assert(max(abs(err(:))) <= 0.5e-3 + 1e-12);
+
+    % saturation, NaN is stored as 0
+    opts = struct('storage', 'column-major');
+    d2 = b.create_data_array('colmajor', 'bar', 'uint8', [2 3], opts);
+    assert(d2.write_quantized(single([0 10 300; -5 NaN 255]), 1) == 3);
+    assert(isequal(d2.read_all(), uint8([0 10 255; 0 0 255])));
+
+    try
+        d1.write_quantized(data, 0);
+        error('writing must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+end
+
+%% Test: Statistics along a dimension
+function [] = test_reduce( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('reducetest', 'nixblock');
+
+    data = sin(reshape(1:6000, 40, 150) / 7) * 10;
+    d1 = b.create_data_array_from_data('rowmajor', 'bar', data);
+    opts = struct('storage', 'column-major');
+    d2 = b.create_data_array_from_data('colmajor', 'bar', data, opts);
+
+    edges = -10:2.5:10;
+    for d = {d1, d2}
+        for dim = 1:2
+            s = d{1}.reduce(dim, struct('edges', edges));
+            err = [s.mean - mean(data, dim), s.std - std(data, 0, dim), ...
+                s.rms - sqrt(mean(data.^2, dim))];
+            assert(max(abs(err(:))) < 1e-12);
+            assert(isequal(s.min, min(data, [], dim)));
+            assert(isequal(s.max, max(data, [], dim)));
+
+            if dim == 1
+                for k = 1:size(data, 2)
+                    assert(isequal(s.histogram(:, k)', histcounts(data(:, k), edges)));
+                end;
+            else
+                assert(isequal(size(s.histogram), [40 length(edges) - 1]));
+                assert(isequal(s.histogram(7, :), histcounts(data(7, :), edges)));
+            end;
+        end;
+    end;
+
+    % the polynomial is applied on request
+    d1.polynom_coefficients = [1 2];
+    s = d1.reduce(2, struct('calibrated', true));
+    assert(max(abs(s.mean - mean(1 + 2 * data, 2))) < 1e-12);
+    assert(isequal(fieldnames(s), {'mean'; 'std'; 'min'; 'max'; 'rms'}));
+end
+
+%% Test: Search values with zone maps
+function [] = test_find_range( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('zonetest', 'nixblock');
+
+    data = int16(mod((1:6000) * 37, 2001) - 1000);
+    data = reshape(data, 40, 150);
+    opts = struct('chunks', [8 16]);
+    d1 = b.create_data_array('rowmajor', 'bar', 'int16', [40 150], opts);
+    d1.write_all(data);
+    opts = struct('chunks', [16 8], 'storage', 'column-major');
+    d2 = b.create_data_array('colmajor', 'bar', 'int16', [40 150], opts);
+    d2.write_all(data);
+
+    for d = {d1, d2}
+        da = d{1};
+        % without a zone map everything is searched
+        assert(isequal(da.find_range(990, 1000), find(data >= 990 & data <= 1000)));
+
+        da.build_zone_map();
+        assert(isequal(da.find_range(-5, 5), find(data >= -5 & data <= 5)));
+        assert(isempty(da.find_range(2000, 3000)));
+
+        % writes and appends update the map
+        da.write_range(int16(5000 * ones(3, 4)), [7 20]);
+        data2 = data;
+        data2(7:9, 20:23) = 5000;
+        assert(isequal(da.find_range(4000, 6000), find(data2 >= 4000 & data2 <= 6000)));
+
+        da.append_data(int16(-7000 * ones(40, 5)), 2);
+        data2(:, end+1:end+5) = -7000;
+        assert(isequal(da.find_range(-8000, -6000), find(data2 <= -6000)));
+        da.drop_zone_map();
+    end;
+end
+
+%% Test: Read the envelope of sampled data
+function [] = test_read_envelope( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('envelopetest', 'nixblock');
+
+    data = sin((1:20000) / 300) .* (1:20000);
+    data = [data; -data];
+    da = b.create_data_array('envelope', 'bar', 'double', [2 20000]);
+    da.write_all(data);
+    da.append_sampled_dimension(1);
+    da.append_sampled_dimension(0.25);
+    da.build_envelope(2);
+
+    % two samples per pixel read the data itself
+    env = da.read_envelope(250, 274.75, 50);
+    assert(env.level == 0);
+    assert(isequal(size(env.min), [2 50]));
+    block = reshape(data(:, 1001:1100), 2, 2, 50);
+    assert(isequal(env.min, squeeze(min(block, [], 2))));
+    assert(isequal(env.max, squeeze(max(block, [], 2))));
+    assert(env.time(2) == 250.5);
+
+    % coarse levels hold all samples of a pixel
+    env = da.read_envelope(0, 5000, 10);
+    assert(env.level > 0);
+    assert(max(env.max(:)) == max(data(:)));
+    assert(min(env.min(:)) == min(data(:)));
+
+    % appends extend it
+    da.append_data(1e6 * ones(2, 4000), 2);
+    env = da.read_envelope(0, 6000, 12);
+    assert(all(env.max(:, end) == 1e6));
+    assert(env.min(1, end) == 1e6);
+    da.drop_envelope();
+end
+
+%% Test: Write all of a compressed array
+function [] = test_write_compressed( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('compressedtest', 'nixblock');
+
+    opts = struct('chunks', [16 100], 'deflate', 6, 'shuffle', true, 'fill', -1);
+    d1 = b.create_data_array('rowmajor', 'bar', 'double', [40 450], opts);
+    data = reshape(1:18000, 40, 450);
+    d1.write_all(data);
+    assert(isequal(d1.read_all(), data));
+    assert(isequal(d1.read_range([1 1], [40 450]), data));
+
+    % the extent changes, the chunks of the old one are overwritten
+    data = data(1:33, 1:401) * 2;
+    d1.write_all(data);
+    assert(isequal(d1.shape, [33 401]));
+    assert(isequal(d1.read_range([1 1], [33 401]), data));
+
+    opts = struct('storage', 'column-major', 'chunks', [7 5 3], 'deflate', 1);
+    d2 = b.create_data_array('colmajor', 'bar', 'int16', [11 21 10], opts);
+    data = int16(reshape(1:2310, 11, 21, 10));
+    d2.write_all(data);
+    assert(isequal(d2.read_range([1 1 1], [11 21 10]), data));
+end
+
+%% Test: Read into a preallocated buffer
+function [] = test_read_into( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('intotest', 'nixblock');
+
+    data = reshape(1:60, 3, 4, 5);
+    d1 = b.create_data_array_from_data('into', 'bar', data);
+
+    buf = zeros(3, 4, 2);
+    for i = 1:4
+        d1.read_into(buf, [1 1 i]);
+        assert(isequal(buf, data(:, :, i:i+1)));
+    end;
+
+    opts = struct('storage', 'column-major');
+    d2 = b.create_data_array_from_data('intocol', 'bar', data, opts);
+    buf = zeros(2, 4);
+    d2.read_into(buf, [2 1 5]);
+    assert(isequal(buf, data(2:3, :, 5)));
+
+    % 1-d data goes into a row vector, like read_all returns it
+    d3 = b.create_data_array('line', 'bar', 'double', 10);
+    d3.write_all(1:10);
+    buf = zeros(1, 4);
+    d3.read_into(buf, 3);
+    assert(isequal(buf, 3:6));
+
+    try
+        d1.read_into(zeros(3, 4, 2, 'single'), [1 1 1]);
+    catch
+        return;
+    end
+    error('reading into a buffer of the wrong class should fail');
+end
+
+%% Test: Scattered and decimated reads
+function [] = test_read_indexed( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('indexedtest', 'nixblock');
+
+    data = reshape(1:600, 10, 12, 5);
+    d1 = b.create_data_array_from_data('indexed', 'bar', data);
+
+    assert(isequal(d1.read_indexed([3 1 3], ':', 5), data([3 1 3], :, 5)));
+    assert(isequal(d1.read_indexed(1:2:10, [12 2 7 8], [1 5]), ...
+        data(1:2:10, [12 2 7 8], [1 5])));
+
+    subs = [1 1 1; 10 12 5; 4 7 2; 4 8 2; 1 1 1];
+    expected = data(sub2ind(size(data), subs(:, 1), subs(:, 2), subs(:, 3)));
+    assert(isequal(d1.read_points(subs), expected));
+
+    assert(isequal(d1.read_strided([1 2 1], [3 5 1], [3 2 5]), data(1:3:7, [2 7], :)));
+    assert(isequal(d1.read_strided([2 1 1], [4 6 1], [2 2 1], [2 3 1]), ...
+        data([2 3 6 7], [1 2 3 7 8 9], 1)));
+
+    opts = struct('storage', 'column-major');
+    d2 = b.create_data_array_from_data('indexedcol', 'bar', data, opts);
+    assert(isequal(d2.read_indexed([3 1 3], ':', [5 2]), data([3 1 3], :, [5 2])));
+    assert(isequal(d2.read_points(subs), expected));
+    assert(isequal(d2.read_strided([1 2 1], [3 5 1], [3 2 5]), data(1:3:7, [2 7], :)));
+
+    try
+        d1.read_indexed(11, 1, 1);
+    catch
+        return;
+    end
+    error('indices outside of the extent of the DataArray should fail');
+end
+
+%% Test: Walk a DataArray block by block
+function [] = test_cursor( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('cursortest', 'nixblock');
+
+    data = reshape(1:2000, 40, 50);
+    opts = struct('storage', 'column-major');
+    das = {b.create_data_array_from_data('cursor', 'bar', data), ...
+        b.create_data_array_from_data('cursorcol', 'bar', data, opts)};
+
+    for i = 1:length(das)
+        c = das{i}.open_cursor();
+        assert(isequal(c.shape, [40 50]));
+
+        seen = zeros(size(data));
+        while c.has_next()
+            [block, offset] = c.next();
+            rows = offset(1):offset(1) + size(block, 1) - 1;
+            cols = offset(2):offset(2) + size(block, 2) - 1;
+            assert(isequal(block, data(rows, cols)));
+            seen(rows, cols) = seen(rows, cols) + 1;
+        end;
+        assert(all(seen(:) == 1));
+
+        c.reset();
+        assert(c.has_next());
+    end;
+end
+
+%% Test: Window scans with read-ahead
+function [] = test_prefetch( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('prefetchtest', 'nixblock');
+
+    data = reshape(1:8000, 8, 1000);
+    d1 = b.create_data_array_from_data('prefetch', 'bar', data);
+    d1.set_prefetch(true);
+
+    buf = zeros(8, 100);
+    for i = 1:100:901
+        assert(isequal(d1.read_range([1 i], [8 100]), data(:, i:i+99)));
+        d1.read_into(buf, [1 i]);
+        assert(isequal(buf, data(:, i:i+99)));
+    end;
+
+    % writes invalidate what has been read ahead
+    d1.read_range([1 1], [8 100]);
+    d1.write_range(zeros(8, 100), [1 101]);
+    assert(isequal(d1.read_range([1 101], [8 100]), zeros(8, 100)));
+
+    d1.set_prefetch(false);
+    assert(isequal(d1.read_range([1 901], [8 100]), data(:, 901:1000)));
+end
+
+%% Test: Write-behind queue
+function [] = test_async_write( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('asynctest', 'nixblock');
+
+    d1 = b.create_data_array('async', 'bar', 'double', [4 100]);
+    d1.set_async_write(true, struct('maxBytes', 1024));
+
+    data = reshape(1:400, 4, 100);
+    for i = 1:10:91
+        d1.write_range(data(:, i:i+9), [1 i]);
+    end;
+
+    % reads wait for the queue
+    assert(isequal(d1.read_all(), data));
+
+    d1.write_range(zeros(4, 10), [1 1]);
+    d1.flush_writes();
+    data(:, 1:10) = 0;
+    assert(isequal(d1.read_range([1 1], [4 20]), data(:, 1:20)));
+
+    % a new extent waits for the writes queued before
+    d2 = b.create_data_array('async2', 'bar', 'double', [2 3]);
+    d2.set_async_write(true);
+    d2.write_range([1 2 3], [1 1]);
+    d2.write_all([1 2; 3 4]);
+    d2.wait_writes();
+    assert(isequal(d2.read_all(), [1 2; 3 4]));
+
+    d1.set_async_write(false);
+    d1.write_range(ones(4, 10), [1 91]);
+    data(:, 91:100) = 1;
+    assert(isequal(d1.read_all(), data));
+end
+
+%% Test: Column-major storage
+function [] = test_column_major( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('colmajortest', 'nixblock');
+
+    data = reshape(1:60, 3, 4, 5);
+    opts = struct('storage', 'column-major');
+    d1 = b.create_data_array_from_data('colmajor', 'bar', data, opts);
+
+    assert(d1.is_column_major());
+    assert(isequal(d1.shape, [3 4 5]));
+    assert(isequal(d1.read_all(), data));
+    assert(isequal(d1.read_range([2 1 3], [2 4 2]), data(2:3, :, 3:4)));
+
+    d1.write_range(zeros(1, 4, 2), [3 1 2]);
+    data(3, :, 2:3) = 0;
+    assert(isequal(d1.read_all(), data));
+
+    d1.append_sampled_dimension(0.1);
+    assert(strcmp(d1.dimensions{1}.dimensionType, 'sample'));
+
+    d2 = b.create_data_array('rowmajor', 'bar', 'double', [3 4]);
+    assert(~d2.is_column_major());
+end
+
+%% Test: Append data along a dimension
+function [] = test_append_data( varargin )
+    f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
+    b = f.createBlock('appendtest', 'nixblock');
+
+    data = reshape(1:40, 4, 10);
+    d1 = b.create_data_array_from_data('stream', 'bar', data);
+    d1.append_sampled_dimension(1);
+    d1.append_sampled_dimension(0.001);
+
+    for i = 1:5
+        block = rand(4, 100);
+        d1.append_data(block, 2);
+        data = [data block];
+    end;
+    assert(isequal(d1.shape, [4 510]));
+    assert(isequal(d1.read_all(), data));
+
+    d1.finish_append();
+    assert(isequal(d1.shape, [4 510]));
+    assert(isequal(d1.read_all(), data));
+
+    d2 = b.create_data_array_from_data('ranged', 'bar', [1; 2; 3]);
+    d2.append_range_dimension([0.5 1 2]);
+    d2.append_data([4; 5], 1, struct('ticks', [3 5]));
+    assert(isequal(d2.read_all(), (1:5)'));
+    assert(isequal(d2.dimensions{1}.ticks(:)', [0.5 1 2 3 5]));
+
+    opts = struct('storage', 'column-major');
+    d3 = b.create_data_array_from_data('colmajor', 'bar', ones(3, 2), opts);
+    d3.append_data(zeros(3, 4), 2, struct('growth', 0));
+    assert(isequal(d3.read_all(), [ones(3, 2) zeros(3, 4)]));
+
+    try
+        d1.append_data(rand(3, 10), 2);
+    catch
+        return;
+    end
+    error('appending data of mismatching shape should fail');
+end
+
 %% Test: Add sources by entity and id
 function [] = test_add_source ( varargin )
     f = nix.File(fullfile(pwd, 'tests', 'testRW.h5'), nix.FileMode.Overwrite);
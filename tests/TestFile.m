@@ -6,6 +6,14 @@ function funcs = testFile
     funcs{end+1} = @test_read_only;
     funcs{end+1} = @test_read_write;
     funcs{end+1} = @test_overwrite;
+    funcs{end+1} = @test_access_options;
+    funcs{end+1} = @test_preload;
+    funcs{end+1} = @test_creation_options;
+    funcs{end+1} = @test_swmr_read;
+    funcs{end+1} = @test_swmr_write;
+    funcs{end+1} = @test_read_batch;
+    funcs{end+1} = @test_shared_cache;
+    funcs{end+1} = @test_open_copy;
     funcs{end+1} = @test_create_block;
     funcs{end+1} = @test_create_section;
     funcs{end+1} = @test_list_sections;
@@ -32,6 +40,222 @@ function [] = test_overwrite( varargin )
     f = nix.File(fullfile(pwd,'tests','testRW.h5'), nix.FileMode.Overwrite);
 end
 
+%% Test: Open HDF5 file with chunk cache and buffer settings
+function [] = test_access_options( varargin )
+    opts = struct('chunkCacheBytes', 64 * 2^20, 'chunkCachePolicy', 1, ...
+        'metadataCacheBytes', 16 * 2^20, 'sieveBufferBytes', 2^20);
+
+    f = nix.File(fullfile(pwd,'tests','testRW.h5'), nix.FileMode.Overwrite, opts);
+    assert(f.info.chunkCacheBytes == 64 * 2^20);
+    assert(f.info.chunkCachePolicy == 1);
+    assert(f.info.metadataCacheBytes == 16 * 2^20);
+    assert(f.info.sieveBufferBytes == 2^20);
+
+    b = f.createBlock('accesstest', 'nixblock');
+    d = b.create_data_array_from_data('data', 'bar', magic(8));
+    assert(isequal(d.read_all(), magic(8)));
+    clear d b f;
+
+    f = nix.File(fullfile(pwd,'tests','testRW.h5'), nix.FileMode.ReadOnly, opts);
+    assert(f.info.chunkCacheBytes == 64 * 2^20);
+    assert(isequal(f.blocks{1}.dataArrays{1}.read_all(), magic(8)));
+end
+
+%% Test: Open HDF5 file preloaded into memory
+function [] = test_preload( varargin )
+    f = nix.File(fullfile(pwd,'tests','test.h5'), nix.FileMode.ReadOnly, ...
+        struct('preload', true));
+    assert(f.info.metadataCacheBytes >= 2^20);
+    assert(~isempty(f.blocks));
+end
+
+%% Test: Create HDF5 file with paged file space
+function [] = test_creation_options( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+    opts = struct('pageSize', 2^16, 'pageBufferBytes', 2^20, ...
+        'metaBlockBytes', 2^16, 'latestFormat', true);
+
+    f = nix.File(fname, nix.FileMode.Overwrite, opts);
+    assert(f.info.pageSize == 2^16);
+    assert(f.info.pageBufferBytes == 2^20);
+    assert(f.info.latestFormat);
+
+    b = f.createBlock('pagedtest', 'nixblock');
+    s = f.createSection('pagedsection', 'nixsection');
+    s.create_property_with_value('p', {1});
+    b.create_data_array_from_data('data', 'bar', magic(4));
+    clear s b f;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly, struct('pageBufferBytes', 2^20));
+    assert(f.info.pageSize == 2^16);
+    assert(isequal(f.blocks{1}.dataArrays{1}.read_all(), magic(4)));
+    assert(strcmp(f.sections{1}.allProperties{1}.name, 'p'));
+    clear f;
+
+    % page buffers need a paged file
+    nix.File(fname, nix.FileMode.Overwrite);
+    try
+        nix.File(fname, nix.FileMode.ReadOnly, struct('pageBufferBytes', 2^20));
+        error('opening must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+end
+
+%% Test: Open HDF5 file for SWMR reading
+function [] = test_swmr_read( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+
+    f = nix.File(fname, nix.FileMode.Overwrite, struct('latestFormat', true));
+    b = f.createBlock('swmrtest', 'nixblock');
+    b.create_data_array_from_data('data', 'bar', magic(4));
+    clear b f;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly, struct('swmr', true));
+    da = f.blocks{1}.dataArrays{1};
+    da.refresh();
+    assert(isequal(da.shape, [4 4]));
+    assert(isequal(da.read_all(), magic(4)));
+    clear da f;
+
+    try
+        nix.File(fname, nix.FileMode.ReadWrite, struct('swmr', true));
+        error('opening must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+end
+
+%% Test: Open HDF5 file as SWMR writer
+function [] = test_swmr_write( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+
+    f = nix.File(fname, nix.FileMode.Overwrite, struct('latestFormat', true));
+    b = f.createBlock('swmrtest', 'nixblock');
+    b.create_data_array('data', 'bar', 'double', [0 8]);
+    clear b f;
+
+    opts = struct('swmr', true, 'flushEvery', 2, 'flushInterval', 100);
+    f = nix.File(fname, nix.FileMode.ReadWrite, opts);
+    assert(f.info.swmr);
+
+    da = f.blocks{1}.dataArrays{1};
+    for i = 1:5
+        da.append_data(i * ones(1, 8), 1);
+        % no pre-allocation for readers to see
+        assert(isequal(da.shape, [i 8]));
+    end;
+    f.flush();
+    assert(isequal(da.read_all(), repmat((1:5)', 1, 8)));
+end
+
+%% Test: Read DataArrays in batches, with and without reader processes
+function [] = test_read_batch( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+
+    f = nix.File(fname, nix.FileMode.Overwrite);
+    b = f.createBlock('batchtest', 'nixblock');
+    b.create_data_array_from_data('a', 'bar', reshape(1:600, 20, 30));
+    opts = struct('storage', 'column-major');
+    b.create_data_array_from_data('b', 'bar', int16(reshape(1:60, 3, 4, 5)), opts);
+    b.create_data_array_from_data('c', 'bar', logical([1 0 1 1]));
+
+    try
+        f.start_readers(2);
+        error('starting must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+    clear b f;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly);
+    das = f.blocks{1}.dataArrays;
+    expected = cellfun(@(da) da.read_all(), das, 'UniformOutput', false);
+
+    assert(isequal(f.read_batch(das), expected));
+
+    % a buffer of 64 bytes makes for many small pieces
+    f.start_readers(2, struct('bufferBytes', 64));
+    assert(isequal(f.read_batch(das), expected));
+
+    data = f.read_batch(das([1 2 1]), {[2 3], [1 2 2], [20 1]}, {[5 6], [3 2 4], [1 30]});
+    assert(isequal(data{1}, expected{1}(2:6, 3:8)));
+    assert(isequal(data{2}, expected{2}(1:3, 2:3, 2:5)));
+    assert(isequal(data{3}, expected{1}(20, :)));
+
+    f.stop_readers();
+    assert(isequal(f.read_batch(das), expected));
+end
+
+%% Test: Read through a chunk cache in shared memory
+function [] = test_shared_cache( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+    cache = 'nix_mx_test_cache';
+    nix.File.remove_shared_cache(cache);
+
+    f = nix.File(fname, nix.FileMode.Overwrite);
+    b = f.createBlock('sharedtest', 'nixblock');
+    data = reshape(1:6000, 40, 150);
+    opts = struct('chunks', [16 32], 'deflate', 6, 'shuffle', true);
+    b.create_data_array_from_data('a', 'bar', data, opts);
+    clear b f;
+
+    opts = struct('sharedCache', cache, 'sharedCacheBytes', 2^20, ...
+        'sharedCacheSlotBytes', 8192);
+    try
+        nix.File(fname, nix.FileMode.ReadWrite, opts);
+        error('opening must fail');
+    catch e
+        assert(isempty(strfind(e.message, 'must fail')));
+    end;
+
+    f = nix.File(fname, nix.FileMode.ReadOnly, opts);
+    d = f.blocks{1}.dataArrays{1};
+
+    % the second reads are served from the cache
+    assert(isequal(d.read_all(), data));
+    assert(isequal(d.read_all(), data));
+    assert(isequal(d.read_range([3 20], [30 100]), data(3:32, 20:119)));
+
+    % another handle of the file shares the cache
+    g = nix.File(fname, nix.FileMode.ReadOnly, opts);
+    assert(isequal(g.blocks{1}.dataArrays{1}.read_range([1 1], [40 10]), data(:, 1:10)));
+
+    nix.File.remove_shared_cache(cache);
+end
+
+%% Test: Open a copy of a file next to the original
+function [] = test_open_copy( varargin )
+    fname = fullfile(pwd,'tests','testRW.h5');
+    cname = fullfile(pwd,'tests','testRW_copy.h5');
+
+    f = nix.File(fname, nix.FileMode.Overwrite);
+    b = f.createBlock('copytest', 'nixblock');
+    opts = struct('storage', 'column-major');
+    b.create_data_array_from_data('data', 'bar', reshape(1:12, 3, 4), opts);
+    clear b f;
+    copyfile(fname, cname);
+
+    % the DataArrays of both files have the same ids
+    f1 = nix.File(fname, nix.FileMode.ReadWrite);
+    f2 = nix.File(cname, nix.FileMode.ReadOnly);
+    d1 = f1.blocks{1}.dataArrays{1};
+    d2 = f2.blocks{1}.dataArrays{1};
+    assert(strcmp(d1.id, d2.id));
+    assert(d1.is_column_major() && d2.is_column_major());
+
+    d1.write_range([100 200], [2 3]);
+    data = reshape(1:12, 3, 4);
+    assert(isequal(d2.read_all(), data));
+    assert(isequal(d2.read_range([2 3], [1 2]), [8 11]));
+    data(2, 3:4) = [100 200];
+    assert(isequal(d1.read_all(), data));
+    assert(isequal(f1.blocks{1}.dataArrays{1}.read_range([2 3], [1 2]), [100 200]));
+
+    clear d1 d2 f1 f2;
+    delete(cname);
+end
+
 %% Test: Create Block
 function [] = test_create_block( varargin )
     test_file = nix.File(fullfile(pwd,'tests','testRW.h5'), nix.FileMode.ReadWrite);
@@ -283,6 +283,10 @@ function [] = test_retrieve_data( varargin )
     
     data = tag.retrieve_data(1);
     assert(~isempty(data));
+
+    buf = zeros(size(data), class(data));
+    tag.retrieve_data_into(1, buf);
+    assert(isequal(buf, data));
 end
 
 %% Test: Retrieve feature data